@@ -1,87 +1,333 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <format>
 #include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
 #include <iostream>
+#include <iterator>
 #include <memory>
 #include <na_error/macros.hpp>
-#include <string>
 
 import na_error;
 import na_glfwapp;
 import na_gl;
 import na_gl_render_common;
+import na_gl_render_debug;
+import na_gl_render_particles;
+import na_gl_render_post;
+import na_gl_render_sprite;
+import na_gl_render_text;
 
-const std::string SPRITE_VERTEX_SHADER_SRC = R"(
-#version 450 core
+constexpr float GRID_SIZE = 32.0f;
+constexpr int TILE_TEXELS = 8;
 
-struct Instance {
-  mat4 local;
-  vec4 tint;
+constexpr std::array PARTICLE_PASSES = {
+    na::gl::ParticlePass::Simulate,
+    na::gl::ParticlePass::Emit,
+    na::gl::ParticlePass::Finalize,
 };
 
-layout (binding = 0) uniform Shared {
-  mat4 view;
-  mat4 projection;
+constexpr glm::vec2 SNAKE_BODY[] = {
+    {12.0f, 16.0f}, {13.0f, 16.0f}, {14.0f, 16.0f},
+    {15.0f, 16.0f}, {15.0f, 17.0f}, {16.0f, 17.0f},
 };
 
-layout (binding = 0, std430) buffer Instances {
-  Instance instances[];
-};
+class SnakeApp : public na::GlfwApplication {
+  std::unique_ptr<na::gl::ProgramCache> _programCache;
+  std::unique_ptr<na::gl::ShaderBatch> _shaderBatch;
+  na::gl::ProgramFuture _spriteProgramFuture;
+  na::gl::ProgramFuture _tilemapProgramFuture;
+  na::gl::ProgramFuture _textProgramFuture;
+  std::array<na::gl::ProgramFuture, 3> _particlePassFutures;
+  na::gl::ProgramFuture _particleProgramFuture;
+  std::unique_ptr<na::gl::ShaderHotReloader> _shaderReloader;
+  na::gl::ReloadableProgramId _spriteProgram{};
+  na::gl::ReloadableProgramId _tilemapProgram{};
+  na::gl::ReloadableProgramId _textProgram{};
+  std::array<na::gl::ReloadableProgramId, 3> _particlePassPrograms{};
+  na::gl::ReloadableProgramId _particleProgram{};
+  std::unique_ptr<na::gl::SpriteRenderer> _spriteRenderer;
+  std::unique_ptr<na::gl::TextureAtlas> _atlas;
+  std::unique_ptr<na::gl::Tilemap> _board;
+  std::unique_ptr<na::gl::TextRenderer> _text;
+  na::gl::TextLabelId _drawsLabel{};
+  na::gl::TextLabelId _postLabel{};
+  std::unique_ptr<na::gl::ParticleSystem> _particles;
+  std::unique_ptr<na::gl::DebugDraw> _debug;
+  std::unique_ptr<na::gl::PostChain> _post;
+  std::unique_ptr<na::gl::CameraBuffer> _cameras;
+  na::gl::CameraId _gameCamera{};
+  na::gl::CameraId _uiCamera{};
+  std::chrono::steady_clock::time_point _loadStartTime;
+  std::chrono::steady_clock::time_point _lastUpdateTime;
 
-vec2 vertices[4] = vec2[](
-  vec2(-0.5, -0.5),
-  vec2(0.5, -0.5),
-  vec2(0.5, 0.5),
-  vec2(-0.5, 0.5)
-);
+  /* An 8x8 tile with a one-texel border in a darker shade. */
+  static std::array<std::byte, TILE_TEXELS * TILE_TEXELS * 4>
+  tileImage(glm::vec3 color) noexcept {
+    std::array<std::byte, TILE_TEXELS * TILE_TEXELS * 4> image{};
+    for (int y = 0; y < TILE_TEXELS; ++y) {
+      for (int x = 0; x < TILE_TEXELS; ++x) {
+        auto edge = x == 0 || y == 0 || x == TILE_TEXELS - 1 ||
+                    y == TILE_TEXELS - 1;
+        auto texel = (edge ? color * 0.8f : color) * 255.0f;
+        auto *pixel = image.data() + (y * TILE_TEXELS + x) * 4;
+        pixel[0] = static_cast<std::byte>(texel.r);
+        pixel[1] = static_cast<std::byte>(texel.g);
+        pixel[2] = static_cast<std::byte>(texel.b);
+        pixel[3] = std::byte{255};
+      }
+    }
+    return image;
+  }
 
-layout (location = 0) out vec4 outTint;
+  /* Floor and walls as one tilemap; after this upload, frames only pay for
+   * cells that change. */
+  na::VoidResult createBoard() noexcept {
+    UNIQUE_RESULT(atlas, na::gl::TextureAtlas::create({.size = 64}));
+    _atlas = std::move(atlas);
+    AUTO_RESULT(floor, _atlas->insert(TILE_TEXELS, TILE_TEXELS,
+                                      tileImage({0.0f, 0.0f, 0.5f})));
+    AUTO_RESULT(wall, _atlas->insert(TILE_TEXELS, TILE_TEXELS,
+                                     tileImage({0.4f, 0.4f, 0.45f})));
+    constexpr int CELLS = static_cast<int>(GRID_SIZE);
+    UNIQUE_RESULT(board,
+                  na::gl::Tilemap::create({.columns = CELLS, .rows = CELLS}));
+    _board = std::move(board);
+    for (int y = 0; y < CELLS; ++y) {
+      for (int x = 0; x < CELLS; ++x) {
+        auto border = x == 0 || y == 0 || x == CELLS - 1 || y == CELLS - 1;
+        _board->set(x, y, border ? wall : floor);
+      }
+    }
+    return {};
+  }
 
-void main() {
-  Instance instance = instances[gl_InstanceID];
-  vec4 position = instance.local * vec4(vertices[gl_VertexID], 0.0, 1.0);
-  outTint = instance.tint;
-  gl_Position = projection * view * position;
-}
+  na::VoidResult finishLoading() noexcept {
+    UNIQUE_RESULT(spriteProgram, _spriteProgramFuture.take());
+    auto spriteFiles = na::gl::spriteShaderFiles();
+    AUTO_RESULT(spriteProgramId,
+                _shaderReloader->add(std::move(spriteProgram), spriteFiles));
+    _spriteProgram = spriteProgramId;
+    UNIQUE_RESULT(tilemapProgram, _tilemapProgramFuture.take());
+    auto tilemapFiles = na::gl::tilemapShaderFiles();
+    AUTO_RESULT(tilemapProgramId,
+                _shaderReloader->add(std::move(tilemapProgram), tilemapFiles));
+    _tilemapProgram = tilemapProgramId;
+    UNIQUE_RESULT(textProgram, _textProgramFuture.take());
+    auto textFiles = na::gl::textShaderFiles();
+    AUTO_RESULT(textProgramId,
+                _shaderReloader->add(std::move(textProgram), textFiles));
+    _textProgram = textProgramId;
+    // The particle shaders #include particle_common.glsl; the reloader
+    // expands it and also rebuilds every pass when it is edited.
+    for (std::size_t i = 0; i < PARTICLE_PASSES.size(); ++i) {
+      UNIQUE_RESULT(passProgram, _particlePassFutures[i].take());
+      auto passFiles = na::gl::particleComputeShaderFiles(PARTICLE_PASSES[i]);
+      AUTO_RESULT(passProgramId,
+                  _shaderReloader->add(std::move(passProgram), passFiles));
+      _particlePassPrograms[i] = passProgramId;
+    }
+    UNIQUE_RESULT(particleProgram, _particleProgramFuture.take());
+    auto particleFiles = na::gl::particleShaderFiles();
+    AUTO_RESULT(particleProgramId, _shaderReloader->add(
+                                       std::move(particleProgram),
+                                       particleFiles));
+    _particleProgram = particleProgramId;
+    // The cache only saves compile time next run; losing it is not fatal.
+    if (_programCache) {
+      if (auto flush = _programCache->flush(); flush.failed()) {
+        std::cerr << flush.error().message() << std::endl;
+      }
+    }
 
-)";
+    std::chrono::duration<double, std::milli> elapsed =
+        std::chrono::steady_clock::now() - _loadStartTime;
+    std::cout << "Shaders ready in " << elapsed.count() << " ms (";
+    if (_programCache) {
+      const auto &cacheStats = _programCache->stats();
+      std::cout << (cacheStats.misses ? "cold" : "warm")
+                << " program cache, hits=" << cacheStats.hits
+                << ", misses=" << cacheStats.misses;
+    } else {
+      std::cout << "no program cache";
+    }
+    std::cout << ", parallel compile="
+              << (_shaderBatch->parallel() ? "yes" : "no") << ")"
+              << std::endl;
+    _shaderBatch.reset();
+    // The first simulated frame must not span the whole load.
+    _lastUpdateTime = std::chrono::steady_clock::now();
+    return {};
+  }
 
-const std::string SPRITE_FRAGMENT_SHADER_SRC = R"(
-#version 450 core
+public:
+  na::VoidResult onInit(const na::GlfwApplicationState &) noexcept override {
+    _loadStartTime = std::chrono::steady_clock::now();
+    // Drivers without program binary formats compile from source.
+    if (auto programCache = na::gl::ProgramCache::open("snake_programs.cache");
+        programCache.ok()) {
+      _programCache = std::make_unique<na::gl::ProgramCache>(
+          std::move(programCache.value()));
+    } else {
+      std::cerr << programCache.error().message() << std::endl;
+    }
+    _shaderBatch = std::make_unique<na::gl::ShaderBatch>(_programCache.get());
+    UNIQUE_RESULT(shaderReloader, na::gl::ShaderHotReloader::create());
+    _shaderReloader = std::move(shaderReloader);
 
-layout (location = 0) in vec4 inTint;
-layout (location = 0) out vec4 outColor;
+    auto spriteSources = na::gl::spriteShaderSources();
+    _spriteProgramFuture = _shaderBatch->add("sprite", spriteSources);
+    auto tilemapSources = na::gl::tilemapShaderSources();
+    _tilemapProgramFuture = _shaderBatch->add("tilemap", tilemapSources);
+    auto textSources = na::gl::textShaderSources();
+    _textProgramFuture = _shaderBatch->add("text", textSources);
+    for (std::size_t i = 0; i < PARTICLE_PASSES.size(); ++i) {
+      auto passSources =
+          na::gl::particleComputeShaderSources(PARTICLE_PASSES[i]);
+      _particlePassFutures[i] = _shaderBatch->add(
+          std::format("particle_pass_{}", i), passSources);
+    }
+    auto particleSources = na::gl::particleShaderSources();
+    _particleProgramFuture = _shaderBatch->add("particle", particleSources);
 
-void main() {
-  outColor = inTint;
-}
+    // The board fills the window, so the HUD shares its units for now.
+    UNIQUE_RESULT(cameras, na::gl::CameraBuffer::create());
+    _cameras = std::move(cameras);
+    auto camera =
+        na::gl::Camera::orthographic({0.0f, 0.0f}, {GRID_SIZE, GRID_SIZE});
+    AUTO_RESULT(gameCamera, _cameras->add(camera));
+    _gameCamera = gameCamera;
+    AUTO_RESULT(uiCamera, _cameras->add(camera));
+    _uiCamera = uiCamera;
 
-)";
+    UNIQUE_RESULT(spriteRenderer, na::gl::SpriteRenderer::create());
+    _spriteRenderer = std::move(spriteRenderer);
+    _spriteRenderer->setCamera(*_cameras, _gameCamera);
+    CHECK_RESULT(createBoard());
+    _board->setCamera(camera.view, camera.projection);
 
-class SnakeApp : public na::GlfwApplication {
-  std::unique_ptr<na::gl::ShaderProgram> _spriteProgram;
+    UNIQUE_RESULT(text, na::gl::TextRenderer::create());
+    _text = std::move(text);
+    _text->setCamera(*_cameras, _uiCamera);
+    _text->addLabel("Snake", {1.5f, GRID_SIZE - 2.5f}, 1.0f);
+    _drawsLabel = _text->addLabel("", {1.5f, 1.5f}, 0.5f,
+                                  glm::vec4(1.0f, 1.0f, 1.0f, 0.7f));
+    _postLabel = _text->addLabel("", {1.5f, GRID_SIZE - 4.0f}, 0.5f,
+                                 glm::vec4(1.0f, 1.0f, 1.0f, 0.7f));
 
-public:
-  na::VoidResult onInit(const na::GlfwApplicationState &) noexcept override {
-    UNIQUE_RESULT(spriteVertexShader,
-                  na::gl::ShaderStage::create(GL_VERTEX_SHADER, "sprite_vs",
-                                              SPRITE_VERTEX_SHADER_SRC));
-    UNIQUE_RESULT(spriteFragmentShader,
-                  na::gl::ShaderStage::create(GL_FRAGMENT_SHADER, "sprite_fs",
-                                              SPRITE_FRAGMENT_SHADER_SRC));
-    UNIQUE_RESULT(spriteProgram,
-                  na::gl::ShaderProgram::create(
-                      {&spriteVertexShader, &spriteFragmentShader}, "sprite"));
-    _spriteProgram =
-        std::make_unique<na::gl::ShaderProgram>(std::move(spriteProgram));
+    UNIQUE_RESULT(particles, na::gl::ParticleSystem::create(
+                                 {.capacity = 4096, .gravity = {0.0f, -6.0f}}));
+    _particles = std::move(particles);
+    _particles->setCamera(camera.view, camera.projection);
+
+    UNIQUE_RESULT(debug, na::gl::DebugDraw::create());
+    _debug = std::move(debug);
+    _debug->setCamera(*_cameras, _gameCamera);
+
+    auto passes = na::gl::bloomPasses({.threshold = 0.8f});
+    passes.push_back(na::gl::vignettePass());
+    passes.push_back(na::gl::crtPass());
+    UNIQUE_RESULT(post, na::gl::PostChain::create(passes));
+    _post = std::move(post);
     return {};
   }
 
   na::VoidResult
   onUpdate(const na::GlfwApplicationState &state) noexcept override {
     CHECK_RESULT(na::GL::instance().viewport(0, 0, state.width, state.height));
+    if (_shaderBatch) {
+      // Every future is resolved once nothing is left compiling.
+      if (_shaderBatch->poll() == 0) {
+        CHECK_RESULT(finishLoading());
+      } else {
+        // Loading screen: keep presenting frames while the driver compiles.
+        na::GL::instance().clearColor(0.0f, 0.0f, 0.0f, 1.0f);
+        return na::GL::instance().clear(GL_COLOR_BUFFER_BIT |
+                                        GL_DEPTH_BUFFER_BIT);
+      }
+    }
+    if (auto reload = _shaderReloader->update(); reload.failed()) {
+      std::cerr << reload.error().message() << std::endl;
+    }
+    CHECK_RESULT(_post->begin(state.width, state.height));
+    CHECK_RESULT(_cameras->beginFrame());
     na::GL::instance().clearColor(0.0f, 0.0f, 0.5f, 1.0f);
     CHECK_RESULT(
         na::GL::instance().clear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
-    return {};
+
+    CHECK_RESULT(_atlas->update());
+    CHECK_RESULT(
+        _board->draw(_shaderReloader->program(_tilemapProgram), *_atlas));
+
+    CHECK_RESULT(_spriteRenderer->begin());
+    na::gl::SpriteMaterial material{
+        .program = &_shaderReloader->program(_spriteProgram)};
+    auto segments = _spriteRenderer->allocate(material, std::size(SNAKE_BODY));
+    for (std::size_t i = 0; i < segments.size(); ++i) {
+      auto local = glm::translate(glm::mat4(1.0f),
+                                  glm::vec3(SNAKE_BODY[i] + 0.5f, 0.0f));
+      segments[i]
+          .set<"local">(glm::scale(local, glm::vec3(0.9f, 0.9f, 1.0f)))
+          .set<"tint">(glm::vec4(0.2f, 0.9f, 0.3f, 1.0f));
+    }
+    CHECK_RESULT(_spriteRenderer->end());
+
+    // Sparks off the head about once a second.
+    auto now = std::chrono::steady_clock::now();
+    // Clamped so a stall, e.g. dragging the window, does not fling
+    // particles through walls.
+    auto deltaTime = std::min(
+        std::chrono::duration<float>(now - _lastUpdateTime).count(), 0.1f);
+    _lastUpdateTime = now;
+    if (state.frame % 60 == 0) {
+      _particles->burst({.origin = SNAKE_BODY[std::size(SNAKE_BODY) - 1] + 0.5f,
+                         .count = 256,
+                         .color = glm::vec4(1.0f, 0.8f, 0.3f, 1.0f),
+                         .speed = 8.0f,
+                         .life = 0.8f,
+                         .size = 0.3f});
+    }
+    na::gl::ParticlePrograms particlePrograms{
+        .simulate = &_shaderReloader->program(_particlePassPrograms[0]),
+        .emit = &_shaderReloader->program(_particlePassPrograms[1]),
+        .finalize = &_shaderReloader->program(_particlePassPrograms[2]),
+    };
+    CHECK_RESULT(_particles->update(deltaTime, particlePrograms));
+    CHECK_RESULT(
+        _particles->draw(_shaderReloader->program(_particleProgram)));
+
+    // Segment bounds and the heading, in debug builds only.
+    for (auto segment : SNAKE_BODY) {
+      _debug->rect(glm::vec3(segment, 0.0f), glm::vec2(1.0f),
+                   glm::vec4(1.0f, 1.0f, 0.0f, 0.5f));
+    }
+    auto head = SNAKE_BODY[std::size(SNAKE_BODY) - 1] + 0.5f;
+    auto neck = SNAKE_BODY[std::size(SNAKE_BODY) - 2] + 0.5f;
+    _debug->arrow(glm::vec3(head, 0.0f), glm::vec3(2.0f * head - neck, 0.0f),
+                  glm::vec4(1.0f, 0.3f, 0.3f, 1.0f));
+    CHECK_RESULT(_debug->draw());
+
+    // Only re-laid out when the count changes.
+    _text->setText(_drawsLabel, std::format("draws {}",
+                                            state.lastFrameStats.drawCalls));
+    // Post pass GPU times from a recent frame, refreshed once a second so
+    // the label is readable and rarely laid out.
+    if (state.frame % 60 == 0 && !_post->timings().empty()) {
+      auto timings = std::format("post {:.2f} ms", _post->totalMilliseconds());
+      for (const auto &timing : _post->timings()) {
+        timings += std::format("\n {} {:.2f}", timing.name,
+                               timing.milliseconds);
+      }
+      _text->setText(_postLabel, timings);
+    }
+    CHECK_RESULT(_text->draw(_shaderReloader->program(_textProgram)));
+    CHECK_RESULT(_cameras->endFrame());
+
+    auto time = std::chrono::duration<float>(now - _loadStartTime);
+    return _post->end(time.count());
   }
 };
 
@@ -1,3 +1,4 @@
 export module na_gl;
 
-export import :wrapper;
\ No newline at end of file
+export import :stats;
+export import :wrapper;
@@ -0,0 +1,116 @@
+module;
+
+#include <cstdint>
+#include <format>
+#include <fstream>
+#include <glad/glad.h>
+#include <string>
+
+export module na_gl:stats;
+
+import na_error;
+
+namespace na {
+
+export struct GlFrameStats {
+  std::uint64_t drawCalls{};
+  std::uint64_t instances{};
+  std::uint64_t primitives{};
+  std::uint64_t programBinds{};
+  std::uint64_t vertexArrayBinds{};
+  std::uint64_t textureBinds{};
+  std::uint64_t bufferBinds{};
+  std::uint64_t framebufferBinds{};
+  std::uint64_t bytesUploaded{};
+  std::uint64_t objectsCreated{};
+};
+
+/* Counters of the calling thread; GL calls are only valid on the thread that
+ * owns the context, so no synchronization is needed. */
+export GlFrameStats &currentGlFrameStats() noexcept {
+  thread_local GlFrameStats stats{};
+  return stats;
+}
+
+export std::uint64_t primitiveCount(GLenum mode, GLsizei count) noexcept {
+  if (count <= 0) {
+    return 0;
+  }
+  auto vertices = static_cast<std::uint64_t>(count);
+  switch (mode) {
+  case GL_POINTS:
+  case GL_LINE_LOOP:
+    return vertices;
+  case GL_LINES:
+    return vertices / 2;
+  case GL_LINE_STRIP:
+    return vertices - 1;
+  case GL_TRIANGLES:
+    return vertices / 3;
+  case GL_TRIANGLE_STRIP:
+  case GL_TRIANGLE_FAN:
+    return vertices >= 3 ? vertices - 2 : 0;
+  default:
+    return 0;
+  }
+}
+
+export enum class GlStatsStreamFormat { None, Csv, Json };
+
+/* Appends one row per frame so submission cost can be compared across runs.
+ * JSON output is one object per line. */
+export class GlStatsStream {
+  std::ofstream _out;
+  GlStatsStreamFormat _format;
+
+  GlStatsStream(std::ofstream out, GlStatsStreamFormat format) noexcept
+      : _out(std::move(out)), _format(format) {}
+
+public:
+  GlStatsStream(const GlStatsStream &) = delete;
+  GlStatsStream &operator=(const GlStatsStream &) = delete;
+  GlStatsStream &operator=(GlStatsStream &&) noexcept = delete;
+  GlStatsStream(GlStatsStream &&other) noexcept = default;
+
+  static Result<GlStatsStream> open(const std::string &path,
+                                    GlStatsStreamFormat format) noexcept {
+    if (format == GlStatsStreamFormat::None) {
+      return SimpleError("no stats stream format given for {}", path);
+    }
+    std::ofstream out(path, std::ios::out | std::ios::trunc);
+    if (!out) {
+      return SimpleError("failed to open stats stream {}", path);
+    }
+    if (format == GlStatsStreamFormat::Csv) {
+      out << "frame,draw_calls,instances,primitives,program_binds,"
+             "vertex_array_binds,texture_binds,buffer_binds,"
+             "framebuffer_binds,bytes_uploaded,objects_created\n";
+    }
+    return GlStatsStream(std::move(out), format);
+  }
+
+  void write(std::uint64_t frame, const GlFrameStats &stats) noexcept {
+    if (_format == GlStatsStreamFormat::Csv) {
+      _out << std::format("{},{},{},{},{},{},{},{},{},{},{}\n", frame,
+                          stats.drawCalls, stats.instances, stats.primitives,
+                          stats.programBinds, stats.vertexArrayBinds,
+                          stats.textureBinds, stats.bufferBinds,
+                          stats.framebufferBinds, stats.bytesUploaded,
+                          stats.objectsCreated);
+    } else if (_format == GlStatsStreamFormat::Json) {
+      _out << std::format(
+          "{{\"frame\":{},\"drawCalls\":{},\"instances\":{},"
+          "\"primitives\":{},\"programBinds\":{},\"vertexArrayBinds\":{},"
+          "\"textureBinds\":{},\"bufferBinds\":{},\"framebufferBinds\":{},"
+          "\"bytesUploaded\":{},\"objectsCreated\":{}}}\n",
+          frame, stats.drawCalls, stats.instances, stats.primitives,
+          stats.programBinds, stats.vertexArrayBinds, stats.textureBinds,
+          stats.bufferBinds, stats.framebufferBinds, stats.bytesUploaded,
+          stats.objectsCreated);
+    }
+  }
+
+  void flush() noexcept { _out.flush(); }
+};
+
+} // namespace na
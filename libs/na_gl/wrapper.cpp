@@ -1,12 +1,17 @@
 module;
 
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
 #include <glad/glad.h>
+#include <span>
 #include <string>
 #include <vector>
 
 export module na_gl:wrapper;
 
 import na_error;
+import :stats;
 
 #define CHECK_GL_ERROR(msg)                                                    \
   if (auto error = glGetError(); error != GL_NO_ERROR) {                       \
@@ -27,18 +32,116 @@ public:
     return {};
   }
 
+  VoidResult bindBuffer(GLenum target, GLuint buffer) noexcept {
+    glBindBuffer(target, buffer);
+    CHECK_GL_ERROR("glBindBuffer");
+    currentGlFrameStats().bufferBinds++;
+    return {};
+  }
+
+  VoidResult bindBufferBase(GLenum target, GLuint index,
+                            GLuint buffer) noexcept {
+    glBindBufferBase(target, index, buffer);
+    CHECK_GL_ERROR("glBindBufferBase");
+    currentGlFrameStats().bufferBinds++;
+    return {};
+  }
+
+  VoidResult bindBufferRange(GLenum target, GLuint index, GLuint buffer,
+                             GLintptr offset, GLsizeiptr size) noexcept {
+    glBindBufferRange(target, index, buffer, offset, size);
+    CHECK_GL_ERROR("glBindBufferRange");
+    currentGlFrameStats().bufferBinds++;
+    return {};
+  }
+
+  VoidResult bindFramebuffer(GLenum target, GLuint framebuffer) noexcept {
+    glBindFramebuffer(target, framebuffer);
+    CHECK_GL_ERROR("glBindFramebuffer");
+    currentGlFrameStats().framebufferBinds++;
+    return {};
+  }
+
+  VoidResult bindProgramPipeline(GLuint pipeline) noexcept {
+    glBindProgramPipeline(pipeline);
+    CHECK_GL_ERROR("glBindProgramPipeline");
+    currentGlFrameStats().programBinds++;
+    return {};
+  }
+
+  VoidResult bindTextureUnit(GLuint unit, GLuint texture) noexcept {
+    glBindTextureUnit(unit, texture);
+    CHECK_GL_ERROR("glBindTextureUnit");
+    currentGlFrameStats().textureBinds++;
+    return {};
+  }
+
+  VoidResult bindVertexArray(GLuint vertexArray) noexcept {
+    glBindVertexArray(vertexArray);
+    CHECK_GL_ERROR("glBindVertexArray");
+    currentGlFrameStats().vertexArrayBinds++;
+    return {};
+  }
+
+  VoidResult blendFunc(GLenum source, GLenum destination) noexcept {
+    glBlendFunc(source, destination);
+    CHECK_GL_ERROR("glBlendFunc");
+    return {};
+  }
+
+  Result<GLenum> checkNamedFramebufferStatus(GLuint framebuffer,
+                                             GLenum target) noexcept {
+    auto status = glCheckNamedFramebufferStatus(framebuffer, target);
+    CHECK_GL_ERROR("glCheckNamedFramebufferStatus");
+    return status;
+  }
+
+  /* Waits up to timeout nanoseconds; returns GL_ALREADY_SIGNALED,
+   * GL_CONDITION_SATISFIED or GL_TIMEOUT_EXPIRED. */
+  Result<GLenum> clientWaitSync(GLsync sync, GLbitfield flags,
+                                GLuint64 timeout) noexcept {
+    auto status = glClientWaitSync(sync, flags, timeout);
+    if (status == GL_WAIT_FAILED) {
+      return SimpleError("glClientWaitSync failed, err={}", glGetError());
+    }
+    return status;
+  }
+
   VoidResult clear(GLbitfield mask) noexcept {
     glClear(mask);
     CHECK_GL_ERROR("glClear");
     return {};
   }
 
+  Result<GLuint> createBuffer() noexcept {
+    GLuint id = 0;
+    glCreateBuffers(1, &id);
+    CHECK_GL_ERROR("glCreateBuffers");
+    if (id == 0) {
+      return SimpleError("glCreateBuffers failed, id=0");
+    }
+    currentGlFrameStats().objectsCreated++;
+    return id;
+  }
+
+  Result<GLuint> createFramebuffer() noexcept {
+    GLuint id = 0;
+    glCreateFramebuffers(1, &id);
+    CHECK_GL_ERROR("glCreateFramebuffers");
+    if (id == 0) {
+      return SimpleError("glCreateFramebuffers failed, id=0");
+    }
+    currentGlFrameStats().objectsCreated++;
+    return id;
+  }
+
   Result<GLuint> createShader(GLenum type) noexcept {
     auto id = glCreateShader(type);
     CHECK_GL_ERROR("glCreateShader");
     if (id == 0) {
       return SimpleError("glCreateShader failed, id=0");
     }
+    currentGlFrameStats().objectsCreated++;
     return id;
   }
 
@@ -47,6 +150,51 @@ public:
     if (id == 0) {
       return SimpleError("glCreateProgram failed, id=0");
     }
+    currentGlFrameStats().objectsCreated++;
+    return id;
+  }
+
+  Result<GLuint> createProgramPipeline() noexcept {
+    GLuint id = 0;
+    glCreateProgramPipelines(1, &id);
+    CHECK_GL_ERROR("glCreateProgramPipelines");
+    if (id == 0) {
+      return SimpleError("glCreateProgramPipelines failed, id=0");
+    }
+    currentGlFrameStats().objectsCreated++;
+    return id;
+  }
+
+  Result<GLuint> createQuery(GLenum target) noexcept {
+    GLuint id = 0;
+    glCreateQueries(target, 1, &id);
+    CHECK_GL_ERROR("glCreateQueries");
+    if (id == 0) {
+      return SimpleError("glCreateQueries failed, id=0");
+    }
+    currentGlFrameStats().objectsCreated++;
+    return id;
+  }
+
+  Result<GLuint> createTexture(GLenum target) noexcept {
+    GLuint id = 0;
+    glCreateTextures(target, 1, &id);
+    CHECK_GL_ERROR("glCreateTextures");
+    if (id == 0) {
+      return SimpleError("glCreateTextures failed, id=0");
+    }
+    currentGlFrameStats().objectsCreated++;
+    return id;
+  }
+
+  Result<GLuint> createVertexArray() noexcept {
+    GLuint id = 0;
+    glCreateVertexArrays(1, &id);
+    CHECK_GL_ERROR("glCreateVertexArrays");
+    if (id == 0) {
+      return SimpleError("glCreateVertexArrays failed, id=0");
+    }
+    currentGlFrameStats().objectsCreated++;
     return id;
   }
 
@@ -57,17 +205,46 @@ public:
   VoidResult compileShader(GLuint shader) noexcept {
     glCompileShader(shader);
     CHECK_GL_ERROR("glCompileShader");
-    GLint status;
-    glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
-    if (!status) {
-      GLint infoLogLen;
-      glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &infoLogLen);
-      std::vector<GLchar> infoLog(infoLogLen);
-      glGetShaderInfoLog(shader, infoLogLen, nullptr, infoLog.data());
-      infoLog.push_back('\0');
-      return SimpleError("glCompileShader, err={}",
-                         std::string(infoLog.data()));
-    }
+    return shaderCompileStatus(shader);
+  }
+
+  /* size is the byte count of data, only used for upload statistics. */
+  VoidResult compressedTextureSubImage2D(GLuint texture, GLint level, GLint x,
+                                         GLint y, GLsizei width,
+                                         GLsizei height, GLenum format,
+                                         GLsizei size,
+                                         const void *data) noexcept {
+    glCompressedTextureSubImage2D(texture, level, x, y, width, height, format,
+                                  size, data);
+    CHECK_GL_ERROR("glCompressedTextureSubImage2D");
+    currentGlFrameStats().bytesUploaded += static_cast<std::size_t>(size);
+    return {};
+  }
+
+  VoidResult copyImageSubData(GLuint source, GLenum sourceTarget,
+                              GLint sourceLevel, GLint sourceX, GLint sourceY,
+                              GLint sourceZ, GLuint destination,
+                              GLenum destinationTarget, GLint destinationLevel,
+                              GLint destinationX, GLint destinationY,
+                              GLint destinationZ, GLsizei width, GLsizei height,
+                              GLsizei depth) noexcept {
+    glCopyImageSubData(source, sourceTarget, sourceLevel, sourceX, sourceY,
+                       sourceZ, destination, destinationTarget,
+                       destinationLevel, destinationX, destinationY,
+                       destinationZ, width, height, depth);
+    CHECK_GL_ERROR("glCopyImageSubData");
+    return {};
+  }
+
+  VoidResult deleteBuffer(GLuint buffer) noexcept {
+    glDeleteBuffers(1, &buffer);
+    CHECK_GL_ERROR("glDeleteBuffers");
+    return {};
+  }
+
+  VoidResult deleteFramebuffer(GLuint framebuffer) noexcept {
+    glDeleteFramebuffers(1, &framebuffer);
+    CHECK_GL_ERROR("glDeleteFramebuffers");
     return {};
   }
 
@@ -77,15 +254,284 @@ public:
     return {};
   }
 
+  VoidResult deleteProgramPipeline(GLuint pipeline) noexcept {
+    glDeleteProgramPipelines(1, &pipeline);
+    CHECK_GL_ERROR("glDeleteProgramPipelines");
+    return {};
+  }
+
+  VoidResult deleteQuery(GLuint query) noexcept {
+    glDeleteQueries(1, &query);
+    CHECK_GL_ERROR("glDeleteQueries");
+    return {};
+  }
+
   VoidResult deleteShader(GLuint shader) noexcept {
     glDeleteShader(shader);
     CHECK_GL_ERROR("glDeleteShader");
     return {};
   }
 
+  VoidResult deleteSync(GLsync sync) noexcept {
+    glDeleteSync(sync);
+    CHECK_GL_ERROR("glDeleteSync");
+    return {};
+  }
+
+  VoidResult deleteTexture(GLuint texture) noexcept {
+    glDeleteTextures(1, &texture);
+    CHECK_GL_ERROR("glDeleteTextures");
+    return {};
+  }
+
+  VoidResult deleteVertexArray(GLuint vertexArray) noexcept {
+    glDeleteVertexArrays(1, &vertexArray);
+    CHECK_GL_ERROR("glDeleteVertexArrays");
+    return {};
+  }
+
+  VoidResult depthFunc(GLenum function) noexcept {
+    glDepthFunc(function);
+    CHECK_GL_ERROR("glDepthFunc");
+    return {};
+  }
+
+  VoidResult depthMask(GLboolean write) noexcept {
+    glDepthMask(write);
+    CHECK_GL_ERROR("glDepthMask");
+    return {};
+  }
+
+  VoidResult disable(GLenum capability) noexcept {
+    glDisable(capability);
+    CHECK_GL_ERROR("glDisable");
+    return {};
+  }
+
+  VoidResult dispatchCompute(GLuint groupsX, GLuint groupsY,
+                             GLuint groupsZ) noexcept {
+    glDispatchCompute(groupsX, groupsY, groupsZ);
+    CHECK_GL_ERROR("glDispatchCompute");
+    return {};
+  }
+
+  /* Reads the group counts from the bound GL_DISPATCH_INDIRECT_BUFFER. */
+  VoidResult dispatchComputeIndirect(GLintptr offset) noexcept {
+    glDispatchComputeIndirect(offset);
+    CHECK_GL_ERROR("glDispatchComputeIndirect");
+    return {};
+  }
+
+  VoidResult drawArrays(GLenum mode, GLint first, GLsizei count) noexcept {
+    glDrawArrays(mode, first, count);
+    CHECK_GL_ERROR("glDrawArrays");
+    auto &stats = currentGlFrameStats();
+    stats.drawCalls++;
+    stats.instances++;
+    stats.primitives += primitiveCount(mode, count);
+    return {};
+  }
+
+  /* The instance and primitive counts live in GPU memory, so only the draw
+   * call is counted. */
+  VoidResult drawArraysIndirect(GLenum mode, GLintptr offset) noexcept {
+    glDrawArraysIndirect(mode, reinterpret_cast<const void *>(offset));
+    CHECK_GL_ERROR("glDrawArraysIndirect");
+    currentGlFrameStats().drawCalls++;
+    return {};
+  }
+
+  VoidResult drawArraysInstanced(GLenum mode, GLint first, GLsizei count,
+                                 GLsizei instanceCount) noexcept {
+    glDrawArraysInstanced(mode, first, count, instanceCount);
+    CHECK_GL_ERROR("glDrawArraysInstanced");
+    auto &stats = currentGlFrameStats();
+    stats.drawCalls++;
+    stats.instances += static_cast<std::uint64_t>(instanceCount);
+    stats.primitives += primitiveCount(mode, count) *
+                        static_cast<std::uint64_t>(instanceCount);
+    return {};
+  }
+
+  VoidResult enable(GLenum capability) noexcept {
+    glEnable(capability);
+    CHECK_GL_ERROR("glEnable");
+    return {};
+  }
+
+  Result<GLsync> fenceSync() noexcept {
+    auto sync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    CHECK_GL_ERROR("glFenceSync");
+    if (sync == nullptr) {
+      return SimpleError("glFenceSync failed, sync=null");
+    }
+    return sync;
+  }
+
+  VoidResult finish() noexcept {
+    glFinish();
+    CHECK_GL_ERROR("glFinish");
+    return {};
+  }
+
+  const GlFrameStats &frameStats() const noexcept {
+    return currentGlFrameStats();
+  }
+
+  Result<GLint> getInteger(GLenum name) noexcept {
+    GLint value = 0;
+    glGetIntegerv(name, &value);
+    CHECK_GL_ERROR("glGetIntegerv");
+    return value;
+  }
+
+  Result<GLint> getInternalformati(GLenum target, GLenum internalFormat,
+                                   GLenum name) noexcept {
+    GLint value = 0;
+    glGetInternalformativ(target, internalFormat, name, 1, &value);
+    CHECK_GL_ERROR("glGetInternalformativ");
+    return value;
+  }
+
+  VoidResult getProgramBinary(GLuint program, GLsizei bufferSize,
+                              GLenum *format, void *binary) noexcept {
+    glGetProgramBinary(program, bufferSize, nullptr, format, binary);
+    CHECK_GL_ERROR("glGetProgramBinary");
+    return {};
+  }
+
+  Result<GLint> getProgramiv(GLuint program, GLenum name) noexcept {
+    GLint value = 0;
+    glGetProgramiv(program, name, &value);
+    CHECK_GL_ERROR("glGetProgramiv");
+    return value;
+  }
+
+  Result<GLint> getProgramInterfaceiv(GLuint program, GLenum interface,
+                                      GLenum name) noexcept {
+    GLint value = 0;
+    glGetProgramInterfaceiv(program, interface, name, &value);
+    CHECK_GL_ERROR("glGetProgramInterfaceiv");
+    return value;
+  }
+
+  VoidResult getProgramResourceiv(GLuint program, GLenum interface,
+                                  GLuint index,
+                                  std::span<const GLenum> properties,
+                                  std::span<GLint> values) noexcept {
+    glGetProgramResourceiv(program, interface, index,
+                           static_cast<GLsizei>(properties.size()),
+                           properties.data(),
+                           static_cast<GLsizei>(values.size()), nullptr,
+                           values.data());
+    CHECK_GL_ERROR("glGetProgramResourceiv");
+    return {};
+  }
+
+  Result<std::string> getProgramResourceName(GLuint program, GLenum interface,
+                                             GLuint index,
+                                             GLsizei maxLength) noexcept {
+    std::string name(static_cast<std::size_t>(std::max(maxLength, 1)), '\0');
+    GLsizei length = 0;
+    glGetProgramResourceName(program, interface, index,
+                             static_cast<GLsizei>(name.size()), &length,
+                             name.data());
+    CHECK_GL_ERROR("glGetProgramResourceName");
+    name.resize(static_cast<std::size_t>(length));
+    return name;
+  }
+
+  Result<std::string> getString(GLenum name) noexcept {
+    auto value = glGetString(name);
+    CHECK_GL_ERROR("glGetString");
+    if (value == nullptr) {
+      return SimpleError("glGetString failed, name={}", name);
+    }
+    return std::string(reinterpret_cast<const char *>(value));
+  }
+
   VoidResult linkProgram(GLuint program) noexcept {
     glLinkProgram(program);
     CHECK_GL_ERROR("glLinkProgram");
+    return programLinkStatus(program);
+  }
+
+  Result<void *> mapNamedBufferRange(GLuint buffer, GLintptr offset,
+                                     GLsizeiptr length,
+                                     GLbitfield access) noexcept {
+    auto mapping = glMapNamedBufferRange(buffer, offset, length, access);
+    CHECK_GL_ERROR("glMapNamedBufferRange");
+    if (mapping == nullptr) {
+      return SimpleError("glMapNamedBufferRange failed, mapping=null");
+    }
+    return mapping;
+  }
+
+  VoidResult memoryBarrier(GLbitfield barriers) noexcept {
+    glMemoryBarrier(barriers);
+    CHECK_GL_ERROR("glMemoryBarrier");
+    return {};
+  }
+
+  /* Raises the number of driver compiler threads when
+   * KHR/ARB_parallel_shader_compile is available; returns whether it is. */
+  bool maxShaderCompilerThreads(GLuint count) noexcept {
+    if (GLAD_GL_KHR_parallel_shader_compile) {
+      glMaxShaderCompilerThreadsKHR(count);
+      return true;
+    }
+    if (GLAD_GL_ARB_parallel_shader_compile) {
+      glMaxShaderCompilerThreadsARB(count);
+      return true;
+    }
+    return false;
+  }
+
+  VoidResult namedBufferStorage(GLuint buffer, GLsizeiptr size,
+                                const void *data, GLbitfield flags) noexcept {
+    glNamedBufferStorage(buffer, size, data, flags);
+    CHECK_GL_ERROR("glNamedBufferStorage");
+    if (data != nullptr) {
+      currentGlFrameStats().bytesUploaded += static_cast<std::uint64_t>(size);
+    }
+    return {};
+  }
+
+  VoidResult namedBufferSubData(GLuint buffer, GLintptr offset,
+                                GLsizeiptr size, const void *data) noexcept {
+    glNamedBufferSubData(buffer, offset, size, data);
+    CHECK_GL_ERROR("glNamedBufferSubData");
+    currentGlFrameStats().bytesUploaded += static_cast<std::uint64_t>(size);
+    return {};
+  }
+
+  VoidResult namedFramebufferDrawBuffers(GLuint framebuffer, GLsizei n,
+                                         const GLenum *buffers) noexcept {
+    glNamedFramebufferDrawBuffers(framebuffer, n, buffers);
+    CHECK_GL_ERROR("glNamedFramebufferDrawBuffers");
+    return {};
+  }
+
+  VoidResult namedFramebufferTexture(GLuint framebuffer, GLenum attachment,
+                                     GLuint texture, GLint level) noexcept {
+    glNamedFramebufferTexture(framebuffer, attachment, texture, level);
+    CHECK_GL_ERROR("glNamedFramebufferTexture");
+    return {};
+  }
+
+  /* Whether a compile or link started on a parallel-compiling driver has
+   * finished; without the extension every query reports completion. */
+  bool programCompletionStatus(GLuint program) noexcept {
+    if (!GLAD_GL_KHR_parallel_shader_compile &&
+        !GLAD_GL_ARB_parallel_shader_compile) {
+      return true;
+    }
+    GLint completed = GL_TRUE;
+    glGetProgramiv(program, GL_COMPLETION_STATUS_KHR, &completed);
+    return completed == GL_TRUE;
+  }
+
+  VoidResult programLinkStatus(GLuint program) noexcept {
     GLint status;
     glGetProgramiv(program, GL_LINK_STATUS, &status);
     if (!status) {
@@ -99,6 +545,197 @@ public:
     return {};
   }
 
+  /* Loads a previously retrieved binary; fails when the driver rejects it,
+   * e.g. after a driver update. */
+  VoidResult programBinary(GLuint program, GLenum format, const void *binary,
+                           GLsizei length) noexcept {
+    glProgramBinary(program, format, binary, length);
+    CHECK_GL_ERROR("glProgramBinary");
+    GLint status;
+    glGetProgramiv(program, GL_LINK_STATUS, &status);
+    if (!status) {
+      return SimpleError("glProgramBinary, binary rejected");
+    }
+    return {};
+  }
+
+  VoidResult programParameteri(GLuint program, GLenum name,
+                               GLint value) noexcept {
+    glProgramParameteri(program, name, value);
+    CHECK_GL_ERROR("glProgramParameteri");
+    return {};
+  }
+
+  /* Uploads count elements of a default-block uniform, dispatching on its
+   * reflected type; samplers and images are set as ints. */
+  VoidResult programUniform(GLuint program, GLint location, GLenum type,
+                            GLsizei count, const void *data) noexcept {
+    auto f = static_cast<const GLfloat *>(data);
+    auto i = static_cast<const GLint *>(data);
+    auto u = static_cast<const GLuint *>(data);
+    auto d = static_cast<const GLdouble *>(data);
+    switch (type) {
+    case GL_FLOAT:
+      glProgramUniform1fv(program, location, count, f);
+      break;
+    case GL_FLOAT_VEC2:
+      glProgramUniform2fv(program, location, count, f);
+      break;
+    case GL_FLOAT_VEC3:
+      glProgramUniform3fv(program, location, count, f);
+      break;
+    case GL_FLOAT_VEC4:
+      glProgramUniform4fv(program, location, count, f);
+      break;
+    case GL_INT_VEC2:
+    case GL_BOOL_VEC2:
+      glProgramUniform2iv(program, location, count, i);
+      break;
+    case GL_INT_VEC3:
+    case GL_BOOL_VEC3:
+      glProgramUniform3iv(program, location, count, i);
+      break;
+    case GL_INT_VEC4:
+    case GL_BOOL_VEC4:
+      glProgramUniform4iv(program, location, count, i);
+      break;
+    case GL_UNSIGNED_INT:
+      glProgramUniform1uiv(program, location, count, u);
+      break;
+    case GL_UNSIGNED_INT_VEC2:
+      glProgramUniform2uiv(program, location, count, u);
+      break;
+    case GL_UNSIGNED_INT_VEC3:
+      glProgramUniform3uiv(program, location, count, u);
+      break;
+    case GL_UNSIGNED_INT_VEC4:
+      glProgramUniform4uiv(program, location, count, u);
+      break;
+    case GL_FLOAT_MAT2:
+      glProgramUniformMatrix2fv(program, location, count, GL_FALSE, f);
+      break;
+    case GL_FLOAT_MAT3:
+      glProgramUniformMatrix3fv(program, location, count, GL_FALSE, f);
+      break;
+    case GL_FLOAT_MAT4:
+      glProgramUniformMatrix4fv(program, location, count, GL_FALSE, f);
+      break;
+    case GL_FLOAT_MAT2x3:
+      glProgramUniformMatrix2x3fv(program, location, count, GL_FALSE, f);
+      break;
+    case GL_FLOAT_MAT2x4:
+      glProgramUniformMatrix2x4fv(program, location, count, GL_FALSE, f);
+      break;
+    case GL_FLOAT_MAT3x2:
+      glProgramUniformMatrix3x2fv(program, location, count, GL_FALSE, f);
+      break;
+    case GL_FLOAT_MAT3x4:
+      glProgramUniformMatrix3x4fv(program, location, count, GL_FALSE, f);
+      break;
+    case GL_FLOAT_MAT4x2:
+      glProgramUniformMatrix4x2fv(program, location, count, GL_FALSE, f);
+      break;
+    case GL_FLOAT_MAT4x3:
+      glProgramUniformMatrix4x3fv(program, location, count, GL_FALSE, f);
+      break;
+    case GL_DOUBLE:
+      glProgramUniform1dv(program, location, count, d);
+      break;
+    case GL_DOUBLE_VEC2:
+      glProgramUniform2dv(program, location, count, d);
+      break;
+    case GL_DOUBLE_VEC3:
+      glProgramUniform3dv(program, location, count, d);
+      break;
+    case GL_DOUBLE_VEC4:
+      glProgramUniform4dv(program, location, count, d);
+      break;
+    case GL_DOUBLE_MAT2:
+      glProgramUniformMatrix2dv(program, location, count, GL_FALSE, d);
+      break;
+    case GL_DOUBLE_MAT3:
+      glProgramUniformMatrix3dv(program, location, count, GL_FALSE, d);
+      break;
+    case GL_DOUBLE_MAT4:
+      glProgramUniformMatrix4dv(program, location, count, GL_FALSE, d);
+      break;
+    case GL_DOUBLE_MAT2x3:
+      glProgramUniformMatrix2x3dv(program, location, count, GL_FALSE, d);
+      break;
+    case GL_DOUBLE_MAT2x4:
+      glProgramUniformMatrix2x4dv(program, location, count, GL_FALSE, d);
+      break;
+    case GL_DOUBLE_MAT3x2:
+      glProgramUniformMatrix3x2dv(program, location, count, GL_FALSE, d);
+      break;
+    case GL_DOUBLE_MAT3x4:
+      glProgramUniformMatrix3x4dv(program, location, count, GL_FALSE, d);
+      break;
+    case GL_DOUBLE_MAT4x2:
+      glProgramUniformMatrix4x2dv(program, location, count, GL_FALSE, d);
+      break;
+    case GL_DOUBLE_MAT4x3:
+      glProgramUniformMatrix4x3dv(program, location, count, GL_FALSE, d);
+      break;
+    default:
+      // GL_INT, GL_BOOL, samplers and images.
+      glProgramUniform1iv(program, location, count, i);
+      break;
+    }
+    CHECK_GL_ERROR("glProgramUniform");
+    return {};
+  }
+
+  /* Records the GPU time once every preceding command has completed. */
+  VoidResult queryCounter(GLuint query) noexcept {
+    glQueryCounter(query, GL_TIMESTAMP);
+    CHECK_GL_ERROR("glQueryCounter");
+    return {};
+  }
+
+  /* Blocks until the result is available; check queryResultAvailable()
+   * first to avoid stalling. */
+  Result<GLuint64> queryResult(GLuint query) noexcept {
+    GLuint64 value = 0;
+    glGetQueryObjectui64v(query, GL_QUERY_RESULT, &value);
+    CHECK_GL_ERROR("glGetQueryObjectui64v");
+    return value;
+  }
+
+  Result<bool> queryResultAvailable(GLuint query) noexcept {
+    GLuint available = GL_FALSE;
+    glGetQueryObjectuiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+    CHECK_GL_ERROR("glGetQueryObjectuiv");
+    return available == GL_TRUE;
+  }
+
+  void resetFrameStats() noexcept { currentGlFrameStats() = {}; }
+
+  VoidResult shaderCompileStatus(GLuint shader) noexcept {
+    GLint status;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+    if (!status) {
+      GLint infoLogLen;
+      glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &infoLogLen);
+      std::vector<GLchar> infoLog(infoLogLen);
+      glGetShaderInfoLog(shader, infoLogLen, nullptr, infoLog.data());
+      infoLog.push_back('\0');
+      return SimpleError("glCompileShader, err={}",
+                         std::string(infoLog.data()));
+    }
+    return {};
+  }
+
+  bool shaderCompletionStatus(GLuint shader) noexcept {
+    if (!GLAD_GL_KHR_parallel_shader_compile &&
+        !GLAD_GL_ARB_parallel_shader_compile) {
+      return true;
+    }
+    GLint completed = GL_TRUE;
+    glGetShaderiv(shader, GL_COMPLETION_STATUS_KHR, &completed);
+    return completed == GL_TRUE;
+  }
+
   VoidResult shaderSource(GLuint shader, GLsizei count,
                           const GLchar *const *string,
                           const GLint *length) noexcept {
@@ -107,6 +744,87 @@ public:
     return {};
   }
 
+  /* Starts compiling without querying the status, which would block. */
+  VoidResult startCompileShader(GLuint shader) noexcept {
+    glCompileShader(shader);
+    CHECK_GL_ERROR("glCompileShader");
+    return {};
+  }
+
+  /* Starts linking without querying the status, which would block. */
+  VoidResult startLinkProgram(GLuint program) noexcept {
+    glLinkProgram(program);
+    CHECK_GL_ERROR("glLinkProgram");
+    return {};
+  }
+
+  VoidResult textureParameteri(GLuint texture, GLenum name,
+                               GLint param) noexcept {
+    glTextureParameteri(texture, name, param);
+    CHECK_GL_ERROR("glTextureParameteri");
+    return {};
+  }
+
+  VoidResult textureStorage2D(GLuint texture, GLsizei levels,
+                              GLenum internalFormat, GLsizei width,
+                              GLsizei height) noexcept {
+    glTextureStorage2D(texture, levels, internalFormat, width, height);
+    CHECK_GL_ERROR("glTextureStorage2D");
+    return {};
+  }
+
+  VoidResult textureStorage3D(GLuint texture, GLsizei levels,
+                              GLenum internalFormat, GLsizei width,
+                              GLsizei height, GLsizei depth) noexcept {
+    glTextureStorage3D(texture, levels, internalFormat, width, height, depth);
+    CHECK_GL_ERROR("glTextureStorage3D");
+    return {};
+  }
+
+  /* size is the byte count of pixels, only used for upload statistics. */
+  VoidResult textureSubImage2D(GLuint texture, GLint level, GLint x, GLint y,
+                               GLsizei width, GLsizei height, GLenum format,
+                               GLenum type, const void *pixels,
+                               std::size_t size) noexcept {
+    glTextureSubImage2D(texture, level, x, y, width, height, format, type,
+                        pixels);
+    CHECK_GL_ERROR("glTextureSubImage2D");
+    currentGlFrameStats().bytesUploaded += size;
+    return {};
+  }
+
+  /* size is the byte count of pixels, only used for upload statistics. */
+  VoidResult textureSubImage3D(GLuint texture, GLint level, GLint x, GLint y,
+                               GLint z, GLsizei width, GLsizei height,
+                               GLsizei depth, GLenum format, GLenum type,
+                               const void *pixels, std::size_t size) noexcept {
+    glTextureSubImage3D(texture, level, x, y, z, width, height, depth, format,
+                        type, pixels);
+    CHECK_GL_ERROR("glTextureSubImage3D");
+    currentGlFrameStats().bytesUploaded += size;
+    return {};
+  }
+
+  VoidResult unmapNamedBuffer(GLuint buffer) noexcept {
+    glUnmapNamedBuffer(buffer);
+    CHECK_GL_ERROR("glUnmapNamedBuffer");
+    return {};
+  }
+
+  VoidResult useProgram(GLuint program) noexcept {
+    glUseProgram(program);
+    CHECK_GL_ERROR("glUseProgram");
+    currentGlFrameStats().programBinds++;
+    return {};
+  }
+
+  VoidResult useProgramStages(GLuint pipeline, GLbitfield stages,
+                              GLuint program) noexcept {
+    glUseProgramStages(pipeline, stages, program);
+    CHECK_GL_ERROR("glUseProgramStages");
+    return {};
+  }
+
   VoidResult viewport(int x, int y, int width, int height) noexcept {
     glViewport(x, y, width, height);
     CHECK_GL_ERROR("glViewport");
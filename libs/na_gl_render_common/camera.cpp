@@ -0,0 +1,162 @@
+module;
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <memory>
+#include <na_error/macros.hpp>
+#include <optional>
+#include <vector>
+
+export module na_gl_render_common:camera;
+
+import na_error;
+import na_gl;
+import :gpu_layout;
+import :stream_buffer;
+
+namespace na::gl {
+
+/* Matches the "Shared" block at UBO binding 0 of the sprite, text and debug
+ * shaders; those reading only view and projection ignore time. */
+export using CameraShared =
+    GpuStruct<"Shared", GpuLayoutRule::Std140, GpuField<"view", glm::mat4>,
+              GpuField<"projection", glm::mat4>, GpuField<"time", float>>;
+
+export struct Camera {
+  glm::mat4 view{1.0f};
+  glm::mat4 projection{1.0f};
+
+  /* Maps min..max in world units to the viewport. */
+  static Camera orthographic(glm::vec2 min, glm::vec2 max, float near = -1.0f,
+                             float far = 1.0f) noexcept {
+    return {glm::mat4(1.0f),
+            glm::ortho(min.x, max.x, min.y, max.y, near, far)};
+  }
+
+  /* fovY in radians. */
+  static Camera perspective(glm::vec3 eye, glm::vec3 target, glm::vec3 up,
+                            float fovY, float aspect, float near,
+                            float far) noexcept {
+    return {glm::lookAt(eye, target, up),
+            glm::perspective(fovY, aspect, near, far)};
+  }
+};
+
+export using CameraId = std::uint32_t;
+
+export struct CameraBufferConfig {
+  std::size_t maxCameras = 8;
+};
+
+/* Owns the Shared block for every camera of a frame. beginFrame() writes
+ * all cameras into the frame's region of a persistently mapped stream, one
+ * aligned slot each, and bind() points binding 0 at a slot with
+ * glBindBufferRange, so switching between the game view, UI and a minimap
+ * mid-frame costs one bind and no upload. Changes made with set() during a
+ * frame apply from the next beginFrame(), as draws already submitted may
+ * still read the current slots. */
+export class CameraBuffer {
+  std::optional<StreamBuffer> _stream;
+  std::size_t _alignment;
+  std::size_t _stride;
+  std::size_t _maxCameras;
+  std::vector<Camera> _cameras;
+  float _time = 0.0f;
+  GLintptr _frameOffset = 0;
+  /* Cameras written by the last beginFrame(). */
+  std::size_t _frameCameras = 0;
+
+  CameraBuffer(std::size_t alignment, std::size_t maxCameras) noexcept
+      : _alignment(alignment),
+        _stride((CameraShared::SIZE + alignment - 1) & ~(alignment - 1)),
+        _maxCameras(maxCameras) {}
+
+  VoidResult checkId(CameraId id) const noexcept {
+    if (id >= _cameras.size()) {
+      return SimpleError("no camera {}, the buffer holds {}", id,
+                         _cameras.size());
+    }
+    return {};
+  }
+
+public:
+  CameraBuffer(const CameraBuffer &) = delete;
+  CameraBuffer &operator=(const CameraBuffer &) = delete;
+
+  static UniqueResult<CameraBuffer>
+  create(CameraBufferConfig config = {}) noexcept {
+    if (config.maxCameras == 0) {
+      return SimpleError("camera buffer needs room for a camera");
+    }
+    AUTO_RESULT(alignment, GL::instance().getInteger(
+                               GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT));
+    auto cameras = std::unique_ptr<CameraBuffer>(new CameraBuffer(
+        static_cast<std::size_t>(alignment), config.maxCameras));
+    UNIQUE_RESULT(stream, StreamBuffer::create(cameras->_stride *
+                                               config.maxCameras));
+    cameras->_stream.emplace(std::move(stream));
+    return cameras;
+  }
+
+  std::size_t size() const noexcept { return _cameras.size(); }
+
+  Result<CameraId> add(const Camera &camera) noexcept {
+    if (_cameras.size() >= _maxCameras) {
+      return SimpleError("camera buffer holds at most {} cameras",
+                         _maxCameras);
+    }
+    _cameras.push_back(camera);
+    return static_cast<CameraId>(_cameras.size() - 1);
+  }
+
+  Result<Camera> camera(CameraId id) const noexcept {
+    CHECK_RESULT(checkId(id));
+    return _cameras[id];
+  }
+
+  VoidResult set(CameraId id, const Camera &camera) noexcept {
+    CHECK_RESULT(checkId(id));
+    _cameras[id] = camera;
+    return {};
+  }
+
+  /* Seconds shared by all cameras; drives flipbook sprites. */
+  void setTime(float seconds) noexcept { _time = seconds; }
+
+  /* Waits for the region written FRAMES frames ago and writes every
+   * camera into it. */
+  VoidResult beginFrame() noexcept {
+    CHECK_RESULT(_stream->beginFrame());
+    auto allocation = *_stream->allocate(_stride * _maxCameras, _alignment);
+    _frameOffset = allocation.offset;
+    _frameCameras = _cameras.size();
+    for (std::size_t i = 0; i < _cameras.size(); ++i) {
+      CameraShared shared{};
+      shared.set<"view">(_cameras[i].view)
+          .set<"projection">(_cameras[i].projection)
+          .set<"time">(_time);
+      std::memcpy(allocation.data + i * _stride, &shared, CameraShared::SIZE);
+    }
+    return {};
+  }
+
+  /* Only cameras added before the frame's beginFrame() have a slot. */
+  VoidResult bind(CameraId id, GLuint binding = 0) const noexcept {
+    if (id >= _frameCameras) {
+      return SimpleError("camera {} was not written by beginFrame()", id);
+    }
+    return GL::instance().bindBufferRange(
+        GL_UNIFORM_BUFFER, binding, _stream->id(),
+        _frameOffset + static_cast<GLintptr>(id * _stride),
+        static_cast<GLsizeiptr>(CameraShared::SIZE));
+  }
+
+  /* Fences the frame's region; call after the last draw using a camera. */
+  VoidResult endFrame() noexcept { return _stream->endFrame(); }
+};
+
+} // namespace na::gl
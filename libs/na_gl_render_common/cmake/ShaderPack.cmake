@@ -0,0 +1,43 @@
+set(NA_SHADER_PACK_SCRIPT ${CMAKE_CURRENT_LIST_DIR}/shader_pack_build.cmake)
+
+# na_add_shader_pack(<target> <module> BASE_DIR <dir> SHADERS <file>...)
+#
+# Packs the shaders (paths relative to BASE_DIR, includes resolved against it
+# and inlined) into one blob embedded with #embed, and adds the generated C++
+# module <module> exporting <module>::PACK, a na::gl::ShaderPack indexing it.
+# Shaders must be ASCII, which is all GLSL allows outside comments, since the
+# blob is embedded into a char array.
+function(na_add_shader_pack target module)
+    cmake_parse_arguments(PACK "" "BASE_DIR" "SHADERS" ${ARGN})
+    set(output_dir ${CMAKE_CURRENT_BINARY_DIR}/${module})
+    set(pack ${output_dir}/${module}.pack)
+    set(interface ${output_dir}/${module}.cpp)
+    list(TRANSFORM PACK_SHADERS PREPEND ${PACK_BASE_DIR}/ OUTPUT_VARIABLE inputs)
+    # Lists cannot be passed through COMMAND arguments as they are.
+    string(REPLACE ";" "|" shaders "${PACK_SHADERS}")
+
+    add_custom_command(
+        OUTPUT ${pack} ${interface}
+        COMMAND ${CMAKE_COMMAND}
+            -DMODULE=${module}
+            -DBASE_DIR=${PACK_BASE_DIR}
+            -DSHADERS=${shaders}
+            -DOUTPUT_DIR=${output_dir}
+            -P ${NA_SHADER_PACK_SCRIPT}
+        DEPENDS ${inputs} ${NA_SHADER_PACK_SCRIPT}
+        DEPFILE ${output_dir}/${module}.d
+        COMMENT "Packing shaders into ${module}"
+        VERBATIM
+    )
+
+    get_target_property(type ${target} TYPE)
+    if(type STREQUAL "EXECUTABLE")
+        set(visibility PRIVATE)
+    else()
+        set(visibility PUBLIC)
+    endif()
+    target_sources(${target} ${visibility}
+        FILE_SET ${module} TYPE CXX_MODULES BASE_DIRS ${output_dir} FILES
+        ${interface}
+    )
+endfunction()
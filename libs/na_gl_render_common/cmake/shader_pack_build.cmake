@@ -0,0 +1,125 @@
+# Build step behind na_add_shader_pack(); run with cmake -P and
+# -DMODULE=<name> -DBASE_DIR=<dir> -DSHADERS=<a|b|...> -DOUTPUT_DIR=<dir>.
+#
+# Writes <MODULE>.pack (every shader with its includes inlined, back to back),
+# <MODULE>.cpp (the module indexing the pack) and <MODULE>.d (a depfile so
+# edits to included files rebuild the pack).
+
+cmake_minimum_required(VERSION 4.0)
+
+string(REPLACE "|" ";" SHADERS "${SHADERS}")
+
+# Expands #include directives of BASE_DIR/<path> the way ShaderPreprocessor
+# does: each file is inlined once per shader, with #line markers whose source
+# number indexes pack_dependencies. Sets pack_expanded in the caller's scope.
+function(pack_expand path source_index stack)
+    if(NOT EXISTS "${BASE_DIR}/${path}")
+        message(FATAL_ERROR "${stack}: cannot find ${path}")
+    endif()
+    file(READ "${BASE_DIR}/${path}" text)
+    # Every line starts with a newline so directives can be matched with \n.
+    set(rest "\n${text}")
+    set(line 0)
+    set(result "")
+    while(TRUE)
+        string(REGEX MATCH "\n[ \t]*#include[ \t]*[\"<]([^\">]+)[\">][^\n]*"
+            match "${rest}")
+        if(NOT match)
+            break()
+        endif()
+        set(include "${CMAKE_MATCH_1}")
+        string(FIND "${rest}" "${match}" at)
+        string(SUBSTRING "${rest}" 0 ${at} before)
+        string(LENGTH "${match}" match_length)
+        math(EXPR after "${at} + ${match_length}")
+        string(SUBSTRING "${rest}" ${after} -1 rest)
+        string(APPEND result "${before}")
+
+        string(REGEX MATCHALL "\n" newlines "${before}")
+        list(LENGTH newlines newline_count)
+        math(EXPR line "${line} + ${newline_count} + 1")
+
+        if("${include}" IN_LIST stack)
+            message(FATAL_ERROR "${path}:${line}: include cycle through ${include}")
+        endif()
+        if("${include}" IN_LIST pack_dependencies)
+            string(APPEND result "\n")
+            continue()
+        endif()
+        list(APPEND pack_dependencies "${include}")
+        list(LENGTH pack_dependencies include_index)
+        pack_expand("${include}" ${include_index} "${stack};${include}")
+        string(APPEND result "\n#line 1 ${include_index}\n${pack_expanded}")
+        math(EXPR next_line "${line} + 1")
+        string(APPEND result "\n#line ${next_line} ${source_index}")
+    endwhile()
+    string(APPEND result "${rest}")
+    string(SUBSTRING "${result}" 1 -1 result)
+    set(pack_expanded "${result}" PARENT_SCOPE)
+    set(pack_dependencies "${pack_dependencies}" PARENT_SCOPE)
+endfunction()
+
+set(blob "")
+set(offset 0)
+set(arrays "")
+set(entries "")
+set(depfile_inputs "")
+set(index 0)
+foreach(shader IN LISTS SHADERS)
+    set(pack_dependencies "")
+    pack_expand("${shader}" 0 "${shader}")
+    string(LENGTH "${pack_expanded}" size)
+    string(APPEND blob "${pack_expanded}")
+
+    list(APPEND depfile_inputs "${BASE_DIR}/${shader}")
+    if(pack_dependencies)
+        set(names "")
+        foreach(dependency IN LISTS pack_dependencies)
+            list(APPEND depfile_inputs "${BASE_DIR}/${dependency}")
+            string(APPEND names "\"${dependency}\", ")
+        endforeach()
+        string(APPEND arrays
+            "inline constexpr std::string_view DEPENDENCIES_${index}[] = {${names}};\n")
+        set(dependencies "DEPENDENCIES_${index}")
+    else()
+        set(dependencies "{}")
+    endif()
+    string(APPEND entries
+        "    na::gl::ShaderPackEntry::make(\"${shader}\", {DATA + ${offset}, ${size}},\n"
+        "                                  ${dependencies}),\n")
+    math(EXPR offset "${offset} + ${size}")
+    math(EXPR index "${index} + 1")
+endforeach()
+
+file(WRITE "${OUTPUT_DIR}/${MODULE}.pack" "${blob}")
+
+file(WRITE "${OUTPUT_DIR}/${MODULE}.cpp"
+"// Generated by shader_pack_build.cmake from ${BASE_DIR}; do not edit.
+module;
+
+#include <string_view>
+
+export module ${MODULE};
+
+import na_gl_render_common;
+
+namespace ${MODULE} {
+
+inline constexpr char DATA[] = {
+#embed \"${MODULE}.pack\"
+};
+
+${arrays}
+inline constexpr na::gl::ShaderPackEntry ENTRIES[] = {
+${entries}};
+
+export inline constexpr na::gl::ShaderPack PACK{ENTRIES};
+
+} // namespace ${MODULE}
+")
+
+list(REMOVE_DUPLICATES depfile_inputs)
+list(TRANSFORM depfile_inputs REPLACE " " "\\\\ ")
+list(JOIN depfile_inputs " " depfile_inputs)
+file(WRITE "${OUTPUT_DIR}/${MODULE}.d"
+    "${OUTPUT_DIR}/${MODULE}.pack: ${depfile_inputs}\n")
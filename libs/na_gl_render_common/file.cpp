@@ -0,0 +1,81 @@
+module;
+
+#include <cstddef>
+#include <fcntl.h>
+#include <fstream>
+#include <iterator>
+#include <span>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+export module na_gl_render_common:file;
+
+import na_error;
+
+namespace na::gl {
+
+export Result<std::string> readTextFile(const std::string &path) noexcept {
+  std::ifstream in(path, std::ios::binary);
+  if (!in) {
+    return SimpleError("failed to open {}", path);
+  }
+  std::string contents((std::istreambuf_iterator<char>(in)),
+                       std::istreambuf_iterator<char>());
+  if (in.bad()) {
+    return SimpleError("failed to read {}", path);
+  }
+  return contents;
+}
+
+/* A read-only memory mapping of a whole file. Pages are faulted in as they
+ * are read, so only the parts of a large asset that are used cost I/O. */
+export class MappedFile {
+  const std::byte *_data = nullptr;
+  std::size_t _size = 0;
+
+  MappedFile(const std::byte *data, std::size_t size) noexcept
+      : _data(data), _size(size) {}
+
+public:
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+  MappedFile &operator=(MappedFile &&) noexcept = delete;
+
+  MappedFile(MappedFile &&other) noexcept
+      : _data(other._data), _size(other._size) {
+    other._data = nullptr;
+    other._size = 0;
+  }
+
+  ~MappedFile() noexcept {
+    if (_data != nullptr) {
+      munmap(const_cast<std::byte *>(_data), _size);
+    }
+  }
+
+  std::span<const std::byte> bytes() const noexcept { return {_data, _size}; }
+
+  static Result<MappedFile> open(const std::string &path) noexcept {
+    auto fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+      return SimpleError("failed to open {}", path);
+    }
+    struct stat status{};
+    if (fstat(fd, &status) != 0 || status.st_size <= 0) {
+      close(fd);
+      return SimpleError("failed to stat {} or it is empty", path);
+    }
+    auto size = static_cast<std::size_t>(status.st_size);
+    auto *data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping keeps its own reference to the file.
+    close(fd);
+    if (data == MAP_FAILED) {
+      return SimpleError("failed to map {}", path);
+    }
+    return MappedFile(static_cast<const std::byte *>(data), size);
+  }
+};
+
+} // namespace na::gl
@@ -0,0 +1,70 @@
+module;
+
+#include <glad/glad.h>
+#include <na_error/macros.hpp>
+
+export module na_gl_render_common:framebuffer;
+
+import na_error;
+import na_gl;
+
+namespace na::gl {
+
+export class Framebuffer {
+  GLuint _id{};
+  Framebuffer(GLuint id) noexcept : _id(id) {}
+
+public:
+  Framebuffer(const Framebuffer &) = delete;
+  Framebuffer &operator=(const Framebuffer &) = delete;
+  Framebuffer &operator=(Framebuffer &&) noexcept = delete;
+
+  Framebuffer(Framebuffer &&other) noexcept : _id(other._id) { other._id = 0; }
+
+  ~Framebuffer() noexcept {
+    if (_id != 0) {
+      GL::instance().deleteFramebuffer(_id);
+    }
+  }
+
+  GLuint id() const noexcept { return _id; }
+
+  VoidResult attach(GLenum attachment, GLuint texture,
+                    GLint level = 0) noexcept {
+    return GL::instance().namedFramebufferTexture(_id, attachment, texture,
+                                                  level);
+  }
+
+  VoidResult setDrawBuffers(GLsizei count) noexcept {
+    GLenum buffers[] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1,
+                        GL_COLOR_ATTACHMENT2, GL_COLOR_ATTACHMENT3};
+    if (count < 0 || count > 4) {
+      return SimpleError("unsupported draw buffer count {}", count);
+    }
+    if (count == 0) {
+      GLenum none = GL_NONE;
+      return GL::instance().namedFramebufferDrawBuffers(_id, 1, &none);
+    }
+    return GL::instance().namedFramebufferDrawBuffers(_id, count, buffers);
+  }
+
+  VoidResult checkComplete() const noexcept {
+    AUTO_RESULT(status, GL::instance().checkNamedFramebufferStatus(
+                            _id, GL_DRAW_FRAMEBUFFER));
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+      return SimpleError("framebuffer {} incomplete, status={}", _id, status);
+    }
+    return {};
+  }
+
+  VoidResult bind() const noexcept {
+    return GL::instance().bindFramebuffer(GL_DRAW_FRAMEBUFFER, _id);
+  }
+
+  static Result<Framebuffer> create() noexcept {
+    AUTO_RESULT(framebufferId, GL::instance().createFramebuffer());
+    return Framebuffer(framebufferId);
+  }
+};
+
+} // namespace na::gl
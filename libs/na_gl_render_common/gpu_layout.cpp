@@ -0,0 +1,393 @@
+module;
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <format>
+#include <glm/glm.hpp>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+
+export module na_gl_render_common:gpu_layout;
+
+namespace na::gl {
+
+export enum class GpuLayoutRule { Std140, Std430 };
+
+export template <std::size_t N> struct FixedString {
+  char data[N]{};
+
+  constexpr FixedString(const char (&text)[N]) noexcept {
+    std::copy_n(text, N, data);
+  }
+
+  constexpr std::string_view view() const noexcept { return {data, N - 1}; }
+};
+
+constexpr std::size_t alignUp(std::size_t value,
+                              std::size_t alignment) noexcept {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+export struct GpuTypeLayout {
+  /* Base alignment of the type under the layout rule. */
+  std::size_t alignment;
+  std::size_t size;
+};
+
+/* Describes how a C++ type maps onto a GLSL type: its layout under each rule,
+ * its GLSL spelling and how to copy it in and out of GPU memory. */
+export template <typename T> struct GpuType;
+
+export template <typename T>
+concept GpuValue = requires {
+  GpuType<T>::template layout<GpuLayoutRule::Std140>();
+  GpuType<T>::glsl();
+};
+
+/* Arrays and matrix columns are padded to a vec4 in std140 only. */
+template <GpuLayoutRule Rule, typename T>
+constexpr GpuTypeLayout arrayElementLayout() noexcept {
+  auto element = GpuType<T>::template layout<Rule>();
+  auto alignment = Rule == GpuLayoutRule::Std140
+                       ? alignUp(element.alignment, 16)
+                       : element.alignment;
+  return {.alignment = alignment, .size = alignUp(element.size, alignment)};
+}
+
+template <typename T> struct GpuScalar {
+  template <GpuLayoutRule> static constexpr GpuTypeLayout layout() noexcept {
+    return {.alignment = 4, .size = 4};
+  }
+
+  template <GpuLayoutRule>
+  static void store(std::byte *destination, const T &value) noexcept {
+    std::memcpy(destination, &value, sizeof(T));
+  }
+
+  template <GpuLayoutRule> static T load(const std::byte *source) noexcept {
+    T value;
+    std::memcpy(&value, source, sizeof(T));
+    return value;
+  }
+};
+
+template <> struct GpuType<float> : GpuScalar<float> {
+  static std::string glsl() noexcept { return "float"; }
+};
+
+template <> struct GpuType<std::int32_t> : GpuScalar<std::int32_t> {
+  static std::string glsl() noexcept { return "int"; }
+};
+
+template <> struct GpuType<std::uint32_t> : GpuScalar<std::uint32_t> {
+  static std::string glsl() noexcept { return "uint"; }
+};
+
+template <typename T> constexpr std::string_view glslTypePrefix() noexcept {
+  if constexpr (std::is_same_v<T, std::int32_t>) {
+    return "i";
+  } else if constexpr (std::is_same_v<T, std::uint32_t>) {
+    return "u";
+  } else {
+    static_assert(std::is_same_v<T, float>, "unsupported vector component");
+    return "";
+  }
+}
+
+template <glm::length_t L, typename T, glm::qualifier Q>
+  requires(L >= 2 && L <= 4)
+struct GpuType<glm::vec<L, T, Q>> {
+  using Vector = glm::vec<L, T, Q>;
+
+  template <GpuLayoutRule> static constexpr GpuTypeLayout layout() noexcept {
+    return {.alignment = L == 2 ? 8u : 16u, .size = L * 4u};
+  }
+
+  static std::string glsl() noexcept {
+    return std::format("{}vec{}", glslTypePrefix<T>(), L);
+  }
+
+  template <GpuLayoutRule>
+  static void store(std::byte *destination, const Vector &value) noexcept {
+    std::memcpy(destination, &value[0], L * sizeof(T));
+  }
+
+  template <GpuLayoutRule>
+  static Vector load(const std::byte *source) noexcept {
+    Vector value;
+    std::memcpy(&value[0], source, L * sizeof(T));
+    return value;
+  }
+};
+
+/* Column-major, laid out like an array of C column vectors. */
+template <glm::length_t C, glm::length_t R, glm::qualifier Q>
+  requires(C >= 2 && C <= 4 && R >= 2 && R <= 4)
+struct GpuType<glm::mat<C, R, float, Q>> {
+  using Matrix = glm::mat<C, R, float, Q>;
+  using Column = glm::vec<R, float, Q>;
+
+  template <GpuLayoutRule Rule>
+  static constexpr GpuTypeLayout layout() noexcept {
+    auto column = arrayElementLayout<Rule, Column>();
+    return {.alignment = column.alignment, .size = C * column.size};
+  }
+
+  static std::string glsl() noexcept {
+    return C == R ? std::format("mat{}", C) : std::format("mat{}x{}", C, R);
+  }
+
+  template <GpuLayoutRule Rule>
+  static void store(std::byte *destination, const Matrix &value) noexcept {
+    constexpr auto stride = arrayElementLayout<Rule, Column>().size;
+    for (glm::length_t c = 0; c < C; ++c) {
+      std::memcpy(destination + c * stride, &value[c][0], R * sizeof(float));
+    }
+  }
+
+  template <GpuLayoutRule Rule>
+  static Matrix load(const std::byte *source) noexcept {
+    constexpr auto stride = arrayElementLayout<Rule, Column>().size;
+    Matrix value;
+    for (glm::length_t c = 0; c < C; ++c) {
+      std::memcpy(&value[c][0], source + c * stride, R * sizeof(float));
+    }
+    return value;
+  }
+};
+
+template <typename T, std::size_t N>
+  requires(N > 0)
+struct GpuType<std::array<T, N>> {
+  template <GpuLayoutRule Rule>
+  static constexpr GpuTypeLayout layout() noexcept {
+    auto element = arrayElementLayout<Rule, T>();
+    return {.alignment = element.alignment, .size = N * element.size};
+  }
+
+  static std::string glsl() noexcept { return GpuType<T>::glsl(); }
+
+  static std::string glslSuffix() noexcept {
+    if constexpr (requires { GpuType<T>::glslSuffix(); }) {
+      return std::format("[{}]{}", N, GpuType<T>::glslSuffix());
+    } else {
+      return std::format("[{}]", N);
+    }
+  }
+
+  template <GpuLayoutRule Rule>
+  static void store(std::byte *destination,
+                    const std::array<T, N> &value) noexcept {
+    constexpr auto stride = arrayElementLayout<Rule, T>().size;
+    for (std::size_t i = 0; i < N; ++i) {
+      GpuType<T>::template store<Rule>(destination + i * stride, value[i]);
+    }
+  }
+
+  template <GpuLayoutRule Rule>
+  static std::array<T, N> load(const std::byte *source) noexcept {
+    constexpr auto stride = arrayElementLayout<Rule, T>().size;
+    std::array<T, N> value;
+    for (std::size_t i = 0; i < N; ++i) {
+      value[i] = GpuType<T>::template load<Rule>(source + i * stride);
+    }
+    return value;
+  }
+};
+
+template <typename T> std::string glslSuffix() noexcept {
+  if constexpr (requires { GpuType<T>::glslSuffix(); }) {
+    return GpuType<T>::glslSuffix();
+  } else {
+    return {};
+  }
+}
+
+export template <FixedString Name, GpuValue T> struct GpuField {
+  static constexpr auto NAME = Name;
+  using Type = T;
+};
+
+template <GpuLayoutRule Rule, typename... Fields> struct GpuStructLayout {
+  static constexpr std::size_t COUNT = sizeof...(Fields);
+
+  struct Computed {
+    std::array<std::size_t, COUNT> offsets{};
+    std::size_t alignment = 0;
+    std::size_t size = 0;
+  };
+
+  static constexpr Computed compute() noexcept {
+    Computed computed;
+    std::size_t offset = 0;
+    std::size_t index = 0;
+    auto place = [&](GpuTypeLayout field) {
+      offset = alignUp(offset, field.alignment);
+      computed.offsets[index++] = offset;
+      offset += field.size;
+      computed.alignment = std::max(computed.alignment, field.alignment);
+    };
+    (place(GpuType<typename Fields::Type>::template layout<Rule>()), ...);
+    // std140 rounds structure alignment up to that of a vec4.
+    if (Rule == GpuLayoutRule::Std140) {
+      computed.alignment = alignUp(computed.alignment, 16);
+    }
+    computed.size = alignUp(offset, computed.alignment);
+    return computed;
+  }
+
+  static constexpr Computed VALUE = compute();
+};
+
+/* A GPU-side struct described once: its storage is laid out by the given
+ * rule, so sizeof() is the array stride the shader uses and a contiguous
+ * array of them can be uploaded with a single memcpy. Fields are accessed by
+ * name through get<"name">() and set<"name">(). */
+export template <FixedString Name, GpuLayoutRule Rule, typename... Fields>
+  requires(sizeof...(Fields) > 0)
+class alignas(GpuStructLayout<Rule, Fields...>::VALUE.alignment) GpuStruct {
+  using Layout = GpuStructLayout<Rule, Fields...>;
+  using Types = std::tuple<typename Fields::Type...>;
+
+  std::byte _storage[Layout::VALUE.size]{};
+
+  template <FixedString Field> static consteval std::size_t fieldIndex() {
+    constexpr std::array<std::string_view, sizeof...(Fields)> names{
+        Fields::NAME.view()...};
+    for (std::size_t i = 0; i < names.size(); ++i) {
+      if (names[i] == Field.view()) {
+        return i;
+      }
+    }
+    return names.size();
+  }
+
+  template <FixedString Field> static consteval std::size_t checkedIndex() {
+    constexpr auto index = fieldIndex<Field>();
+    static_assert(index < sizeof...(Fields), "no such GpuStruct field");
+    return index;
+  }
+
+  template <FixedString Field>
+  using FieldType = std::tuple_element_t<checkedIndex<Field>(), Types>;
+
+  template <std::size_t... I>
+  static std::string glslMembers(std::index_sequence<I...>) noexcept {
+    std::string members;
+    ((members += std::format(
+          "  {} {}{};\n", GpuType<std::tuple_element_t<I, Types>>::glsl(),
+          std::tuple_element_t<I, std::tuple<Fields...>>::NAME.view(),
+          glslSuffix<std::tuple_element_t<I, Types>>())),
+     ...);
+    return members;
+  }
+
+public:
+  static constexpr GpuLayoutRule RULE = Rule;
+  static constexpr std::string_view NAME = Name.view();
+  static constexpr std::size_t SIZE = Layout::VALUE.size;
+  static constexpr std::size_t ALIGNMENT = Layout::VALUE.alignment;
+
+  template <FixedString Field> static constexpr std::size_t offsetOf() noexcept {
+    return Layout::VALUE.offsets[checkedIndex<Field>()];
+  }
+
+  template <FixedString Field> FieldType<Field> get() const noexcept {
+    static_assert(sizeof(GpuStruct) == SIZE && alignof(GpuStruct) == ALIGNMENT);
+    return GpuType<FieldType<Field>>::template load<Rule>(_storage +
+                                                          offsetOf<Field>());
+  }
+
+  template <FixedString Field>
+  GpuStruct &set(const FieldType<Field> &value) noexcept {
+    static_assert(sizeof(GpuStruct) == SIZE && alignof(GpuStruct) == ALIGNMENT);
+    GpuType<FieldType<Field>>::template store<Rule>(_storage + offsetOf<Field>(),
+                                                    value);
+    return *this;
+  }
+
+  /* "struct Name { ... };"; nested struct types are not emitted. */
+  static std::string glslStruct() noexcept {
+    return std::format("struct {} {{\n{}}};\n", NAME,
+                       glslMembers(std::index_sequence_for<Fields...>{}));
+  }
+
+  /* An interface block whose members are this struct's fields, e.g.
+   * glslBlock("uniform", 0) for a UBO. */
+  static std::string glslBlock(std::string_view storage,
+                               std::uint32_t binding) noexcept {
+    return std::format("layout (binding = {}, {}) {} {} {{\n{}}};\n", binding,
+                       Rule == GpuLayoutRule::Std140 ? "std140" : "std430",
+                       storage, NAME,
+                       glslMembers(std::index_sequence_for<Fields...>{}));
+  }
+};
+
+template <typename T> struct IsGpuStruct : std::false_type {};
+
+template <FixedString Name, GpuLayoutRule Rule, typename... Fields>
+struct IsGpuStruct<GpuStruct<Name, Rule, Fields...>> : std::true_type {};
+
+export template <typename T>
+concept GpuStructType = IsGpuStruct<T>::value;
+
+/* Nested structs must use the layout rule of the struct containing them. */
+template <GpuStructType T> struct GpuType<T> {
+  template <GpuLayoutRule Rule>
+  static constexpr GpuTypeLayout layout() noexcept {
+    static_assert(T::RULE == Rule, "nested GpuStruct uses another rule");
+    return {.alignment = T::ALIGNMENT, .size = T::SIZE};
+  }
+
+  static std::string glsl() noexcept { return std::string(T::NAME); }
+
+  template <GpuLayoutRule>
+  static void store(std::byte *destination, const T &value) noexcept {
+    std::memcpy(destination, &value, sizeof(T));
+  }
+
+  template <GpuLayoutRule> static T load(const std::byte *source) noexcept {
+    T value;
+    std::memcpy(&value, source, sizeof(T));
+    return value;
+  }
+};
+
+/* A std430 storage block holding a runtime-sized array of T, e.g.
+ * "buffer Instances { Instance instances[]; }". */
+export template <GpuStructType T>
+std::string glslStorageArray(std::string_view blockName,
+                             std::string_view member,
+                             std::uint32_t binding) noexcept {
+  static_assert(T::RULE == GpuLayoutRule::Std430,
+                "storage arrays of std140 structs waste their padding");
+  return std::format("layout (binding = {}, std430) buffer {} {{\n  {} {}[];\n}};\n",
+                     binding, blockName, T::NAME, member);
+}
+
+// Spot checks of the rules, including the cases std140 and std430 disagree on.
+using Std140Check =
+    GpuStruct<"Std140Check", GpuLayoutRule::Std140, GpuField<"a", float>,
+              GpuField<"b", glm::vec3>, GpuField<"c", float>,
+              GpuField<"d", std::array<float, 2>>, GpuField<"e", glm::mat3>>;
+static_assert(Std140Check::offsetOf<"b">() == 16);
+static_assert(Std140Check::offsetOf<"c">() == 28);
+static_assert(Std140Check::offsetOf<"d">() == 32);
+static_assert(Std140Check::offsetOf<"e">() == 64);
+static_assert(Std140Check::SIZE == 112);
+
+using Std430Check =
+    GpuStruct<"Std430Check", GpuLayoutRule::Std430, GpuField<"a", float>,
+              GpuField<"b", std::array<float, 2>>, GpuField<"c", glm::vec2>,
+              GpuField<"d", glm::mat4>>;
+static_assert(Std430Check::offsetOf<"b">() == 4);
+static_assert(Std430Check::offsetOf<"c">() == 16);
+static_assert(Std430Check::offsetOf<"d">() == 32);
+static_assert(Std430Check::SIZE == 96);
+
+} // namespace na::gl
@@ -0,0 +1,101 @@
+module;
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <glad/glad.h>
+#include <memory>
+#include <na_error/macros.hpp>
+#include <span>
+#include <vector>
+
+export module na_gl_render_common:gpu_timer;
+
+import na_error;
+import na_gl;
+
+namespace na::gl {
+
+/* Measures GPU time between marks with GL_TIMESTAMP queries. A frame's
+ * queries are only read back once the driver reports them available, up to
+ * FRAMES frames later, so reading never stalls the pipeline. */
+export class GpuTimer {
+  static constexpr std::size_t FRAMES = 3;
+
+  std::size_t _maxMarks;
+  std::array<std::vector<GLuint>, FRAMES> _queries;
+  std::array<std::size_t, FRAMES> _marks{};
+  std::size_t _frame = 0;
+  std::vector<double> _intervals;
+
+  explicit GpuTimer(std::size_t maxMarks) noexcept : _maxMarks(maxMarks) {}
+
+  /* Reads the slot about to be reused if its last query has landed. */
+  VoidResult resolve(std::size_t frame) noexcept {
+    auto marks = _marks[frame];
+    if (marks < 2) {
+      return {};
+    }
+    const auto &queries = _queries[frame];
+    AUTO_RESULT(available,
+                GL::instance().queryResultAvailable(queries[marks - 1]));
+    if (!available) {
+      return {};
+    }
+    AUTO_RESULT(previous, GL::instance().queryResult(queries[0]));
+    _intervals.resize(marks - 1);
+    for (std::size_t i = 1; i < marks; ++i) {
+      AUTO_RESULT(time, GL::instance().queryResult(queries[i]));
+      _intervals[i - 1] = static_cast<double>(time - previous) * 1e-6;
+      previous = time;
+    }
+    return {};
+  }
+
+public:
+  GpuTimer(const GpuTimer &) = delete;
+  GpuTimer &operator=(const GpuTimer &) = delete;
+
+  ~GpuTimer() noexcept {
+    for (const auto &queries : _queries) {
+      for (auto query : queries) {
+        GL::instance().deleteQuery(query);
+      }
+    }
+  }
+
+  static UniqueResult<GpuTimer> create(std::size_t maxMarks) noexcept {
+    auto timer = std::unique_ptr<GpuTimer>(new GpuTimer(maxMarks));
+    for (auto &queries : timer->_queries) {
+      for (std::size_t i = 0; i < maxMarks; ++i) {
+        AUTO_RESULT(query, GL::instance().createQuery(GL_TIMESTAMP));
+        queries.push_back(query);
+      }
+    }
+    return timer;
+  }
+
+  /* Picks up results from an earlier frame and starts recording marks. */
+  VoidResult beginFrame() noexcept {
+    _frame = (_frame + 1) % FRAMES;
+    CHECK_RESULT(resolve(_frame));
+    _marks[_frame] = 0;
+    return {};
+  }
+
+  /* Timestamps the point in the command stream; marks past maxMarks in a
+   * frame are ignored. */
+  VoidResult mark() noexcept {
+    auto &marks = _marks[_frame];
+    if (marks >= _maxMarks) {
+      return {};
+    }
+    return GL::instance().queryCounter(_queries[_frame][marks++]);
+  }
+
+  /* Milliseconds between consecutive marks of the latest frame whose
+   * results arrived; empty until one has. */
+  std::span<const double> intervals() const noexcept { return _intervals; }
+};
+
+} // namespace na::gl
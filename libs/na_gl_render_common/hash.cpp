@@ -0,0 +1,40 @@
+module;
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+
+export module na_gl_render_common:hash;
+
+namespace na::gl {
+
+export constexpr std::uint64_t HASH_SEED = 14695981039346656037ull;
+
+/* 64-bit FNV-1a, usable at compile time for precomputed lookup keys. */
+export constexpr std::uint64_t hashString(std::string_view data,
+                                          std::uint64_t seed = HASH_SEED) noexcept {
+  auto hash = seed;
+  for (auto c : data) {
+    hash ^= static_cast<std::uint8_t>(c);
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+export std::uint64_t hashBytes(std::span<const std::byte> data,
+                               std::uint64_t seed = HASH_SEED) noexcept {
+  auto hash = seed;
+  for (auto b : data) {
+    hash ^= static_cast<std::uint8_t>(b);
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+export constexpr std::uint64_t hashCombine(std::uint64_t seed,
+                                           std::uint64_t value) noexcept {
+  return seed ^ (value + 0x9e3779b97f4a7c15ull + (seed << 12) + (seed >> 4));
+}
+
+} // namespace na::gl
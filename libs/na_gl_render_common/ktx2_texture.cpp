@@ -0,0 +1,485 @@
+module;
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <glad/glad.h>
+#include <iterator>
+#include <memory>
+#include <na_error/macros.hpp>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+export module na_gl_render_common:ktx2_texture;
+
+import na_error;
+import na_gl;
+import na_jobs;
+import :file;
+import :texture;
+
+namespace na::gl {
+
+constexpr std::array<std::uint8_t, 12> KTX2_IDENTIFIER = {
+    0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A};
+
+/* File header and index, little-endian as on every target we build for. */
+struct Ktx2Header {
+  std::array<std::uint8_t, 12> identifier;
+  std::uint32_t vkFormat;
+  std::uint32_t typeSize;
+  std::uint32_t pixelWidth;
+  std::uint32_t pixelHeight;
+  std::uint32_t pixelDepth;
+  std::uint32_t layerCount;
+  std::uint32_t faceCount;
+  std::uint32_t levelCount;
+  std::uint32_t supercompressionScheme;
+  std::uint32_t dfdByteOffset;
+  std::uint32_t dfdByteLength;
+  std::uint32_t kvdByteOffset;
+  std::uint32_t kvdByteLength;
+  std::uint64_t sgdByteOffset;
+  std::uint64_t sgdByteLength;
+};
+
+static_assert(sizeof(Ktx2Header) == 80);
+
+struct Ktx2LevelIndex {
+  std::uint64_t byteOffset;
+  std::uint64_t byteLength;
+  std::uint64_t uncompressedByteLength;
+};
+
+/* How a VkFormat maps onto GL. Uncompressed formats have 1x1 blocks of
+ * blockBytes each. */
+struct Ktx2Format {
+  std::uint32_t vkFormat;
+  GLenum internalFormat;
+  std::uint32_t blockSize;
+  std::uint32_t blockBytes;
+  bool srgb;
+};
+
+constexpr Ktx2Format KTX2_FORMATS[] = {
+    {37, GL_RGBA8, 1, 4, false},
+    {43, GL_SRGB8_ALPHA8, 1, 4, true},
+    {131, GL_COMPRESSED_RGB_S3TC_DXT1_EXT, 4, 8, false},
+    {132, GL_COMPRESSED_SRGB_S3TC_DXT1_EXT, 4, 8, true},
+    {133, GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, 4, 8, false},
+    {134, GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT, 4, 8, true},
+    {135, GL_COMPRESSED_RGBA_S3TC_DXT3_EXT, 4, 16, false},
+    {136, GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT, 4, 16, true},
+    {137, GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, 4, 16, false},
+    {138, GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT, 4, 16, true},
+    {139, GL_COMPRESSED_RED_RGTC1, 4, 8, false},
+    {140, GL_COMPRESSED_SIGNED_RED_RGTC1, 4, 8, false},
+    {141, GL_COMPRESSED_RG_RGTC2, 4, 16, false},
+    {142, GL_COMPRESSED_SIGNED_RG_RGTC2, 4, 16, false},
+    {143, GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT, 4, 16, false},
+    {144, GL_COMPRESSED_RGB_BPTC_SIGNED_FLOAT, 4, 16, false},
+    {145, GL_COMPRESSED_RGBA_BPTC_UNORM, 4, 16, false},
+    {146, GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM, 4, 16, true},
+    {147, GL_COMPRESSED_RGB8_ETC2, 4, 8, false},
+    {148, GL_COMPRESSED_SRGB8_ETC2, 4, 8, true},
+    {149, GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2, 4, 8, false},
+    {150, GL_COMPRESSED_SRGB8_PUNCHTHROUGH_ALPHA1_ETC2, 4, 8, true},
+    {151, GL_COMPRESSED_RGBA8_ETC2_EAC, 4, 16, false},
+    {152, GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC, 4, 16, true},
+    {153, GL_COMPRESSED_R11_EAC, 4, 8, false},
+    {154, GL_COMPRESSED_SIGNED_R11_EAC, 4, 8, false},
+    {155, GL_COMPRESSED_RG11_EAC, 4, 16, false},
+    {156, GL_COMPRESSED_SIGNED_RG11_EAC, 4, 16, false},
+};
+
+/* BC1-3 are the only formats outside core GL 4.5, so they are the only ones
+ * that may need decoding on the CPU. */
+enum class Ktx2Transcode { None, Bc1, Bc1Alpha, Bc2, Bc3 };
+
+Ktx2Transcode transcodeFor(GLenum internalFormat) noexcept {
+  switch (internalFormat) {
+  case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+  case GL_COMPRESSED_SRGB_S3TC_DXT1_EXT:
+    return Ktx2Transcode::Bc1;
+  case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+  case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT:
+    return Ktx2Transcode::Bc1Alpha;
+  case GL_COMPRESSED_RGBA_S3TC_DXT3_EXT:
+  case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT:
+    return Ktx2Transcode::Bc2;
+  case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+  case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT:
+    return Ktx2Transcode::Bc3;
+  default:
+    return Ktx2Transcode::None;
+  }
+}
+
+template <typename T> T readLittle(const std::byte *bytes) noexcept {
+  T value;
+  std::memcpy(&value, bytes, sizeof(T));
+  return value;
+}
+
+/* How a BC1 color block with color0 <= color1 is read. */
+enum class Bc1Mode {
+  /* BC2 and BC3 color blocks: always four colors. */
+  FourColors,
+  /* RGB DXT1: three colors, index 3 is opaque black. */
+  Opaque,
+  /* RGBA DXT1: three colors, index 3 is transparent black. */
+  PunchThrough,
+};
+
+/* Decodes a BC1 color block into 16 RGBA8 texels. */
+void decodeBc1Colors(const std::byte *block, Bc1Mode mode,
+                     std::uint8_t (&texels)[16][4]) noexcept {
+  auto expand = [](std::uint16_t color) noexcept {
+    auto r = (color >> 11) & 31;
+    auto g = (color >> 5) & 63;
+    auto b = color & 31;
+    return std::array<int, 4>{(r << 3) | (r >> 2), (g << 2) | (g >> 4),
+                              (b << 3) | (b >> 2), 255};
+  };
+  auto color0 = readLittle<std::uint16_t>(block);
+  auto color1 = readLittle<std::uint16_t>(block + 2);
+  auto indices = readLittle<std::uint32_t>(block + 4);
+  std::array<std::array<int, 4>, 4> palette{expand(color0), expand(color1)};
+  auto fourColors = mode == Bc1Mode::FourColors || color0 > color1;
+  for (std::size_t c = 0; c < 3; ++c) {
+    if (fourColors) {
+      palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+      palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+    } else {
+      palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+      palette[3][c] = 0;
+    }
+  }
+  palette[2][3] = 255;
+  palette[3][3] = fourColors || mode == Bc1Mode::Opaque ? 255 : 0;
+  for (std::size_t i = 0; i < 16; ++i) {
+    const auto &color = palette[(indices >> (2 * i)) & 3];
+    for (std::size_t c = 0; c < 4; ++c) {
+      texels[i][c] = static_cast<std::uint8_t>(color[c]);
+    }
+  }
+}
+
+void decodeBc3Alpha(const std::byte *block,
+                    std::uint8_t (&texels)[16][4]) noexcept {
+  int alpha0 = std::to_integer<int>(block[0]);
+  int alpha1 = std::to_integer<int>(block[1]);
+  std::array<int, 8> palette{alpha0, alpha1};
+  if (alpha0 > alpha1) {
+    for (int i = 1; i < 7; ++i) {
+      palette[i + 1] = ((7 - i) * alpha0 + i * alpha1) / 7;
+    }
+  } else {
+    for (int i = 1; i < 5; ++i) {
+      palette[i + 1] = ((5 - i) * alpha0 + i * alpha1) / 5;
+    }
+    palette[6] = 0;
+    palette[7] = 255;
+  }
+  std::uint64_t indices = 0;
+  std::memcpy(&indices, block + 2, 6);
+  for (std::size_t i = 0; i < 16; ++i) {
+    auto index = static_cast<std::size_t>((indices >> (3 * i)) & 7);
+    texels[i][3] = static_cast<std::uint8_t>(palette[index]);
+  }
+}
+
+void decodeBc2Alpha(const std::byte *block,
+                    std::uint8_t (&texels)[16][4]) noexcept {
+  auto alphas = readLittle<std::uint64_t>(block);
+  for (std::size_t i = 0; i < 16; ++i) {
+    auto alpha = (alphas >> (4 * i)) & 15;
+    texels[i][3] = static_cast<std::uint8_t>(alpha * 17);
+  }
+}
+
+export struct Ktx2TextureConfig {
+  /* Decodes levels in formats the driver lacks on its workers; without one
+   * they are decoded by stream() on the calling thread. */
+  ThreadPool *pool = nullptr;
+  /* Block rows per decode job. */
+  std::size_t decodeGrain = 16;
+};
+
+/* A texture read from a KTX2 container. The file is memory-mapped and each
+ * mip level is uploaded straight from the mapping with
+ * glCompressedTextureSubImage2D, smallest level first: create() uploads only
+ * the smallest one and stream() the next larger ones within a byte budget,
+ * moving GL_TEXTURE_BASE_LEVEL down so sampling only ever sees uploaded
+ * levels. BC1-3 payloads on drivers without S3TC are decoded to RGBA8.
+ * Supercompressed (Basis, zstd, zlib) files are rejected. */
+export class Ktx2Texture {
+  struct Level {
+    std::span<const std::byte> data;
+    GLsizei width;
+    GLsizei height;
+  };
+
+  MappedFile _file;
+  std::optional<Texture> _texture;
+  Ktx2Format _format;
+  Ktx2Transcode _transcode = Ktx2Transcode::None;
+  std::vector<Level> _levels;
+  ThreadPool *_pool;
+  std::size_t _decodeGrain;
+  /* Smallest uploaded level index; _levels.size() before any upload. */
+  std::size_t _baseLevel = 0;
+  std::vector<std::vector<std::uint8_t>> _decoded;
+  /* Declared last so pending decodes finish before their buffers go. */
+  std::vector<ParallelFor> _decodes;
+
+  Ktx2Texture(MappedFile file, Ktx2Format format,
+              Ktx2TextureConfig config) noexcept
+      : _file(std::move(file)), _format(format), _pool(config.pool),
+        _decodeGrain(config.decodeGrain) {}
+
+  Result<std::vector<Level>> parseLevels(const Ktx2Header &header) noexcept {
+    auto bytes = _file.bytes();
+    auto count = std::max<std::uint32_t>(header.levelCount, 1);
+    if (sizeof(Ktx2Header) + count * sizeof(Ktx2LevelIndex) > bytes.size()) {
+      return SimpleError("KTX2 level index is truncated");
+    }
+    std::vector<Level> levels;
+    for (std::uint32_t i = 0; i < count; ++i) {
+      Ktx2LevelIndex index;
+      std::memcpy(&index,
+                  bytes.data() + sizeof(Ktx2Header) + i * sizeof(index),
+                  sizeof(index));
+      auto width = std::max<std::uint32_t>(header.pixelWidth >> i, 1);
+      auto height = std::max<std::uint32_t>(header.pixelHeight >> i, 1);
+      auto blocksX = (width + _format.blockSize - 1) / _format.blockSize;
+      auto blocksY = (height + _format.blockSize - 1) / _format.blockSize;
+      auto expected = std::uint64_t{blocksX} * blocksY * _format.blockBytes;
+      // Compared without adding, so a crafted offset cannot wrap around.
+      if (index.byteLength < expected || index.byteOffset > bytes.size() ||
+          index.byteLength > bytes.size() - index.byteOffset) {
+        return SimpleError("KTX2 level {} holds {} bytes at {}, expected {} "
+                           "within {}",
+                           i, index.byteLength, index.byteOffset, expected,
+                           bytes.size());
+      }
+      levels.push_back({bytes.subspan(index.byteOffset, expected),
+                        static_cast<GLsizei>(width),
+                        static_cast<GLsizei>(height)});
+    }
+    return levels;
+  }
+
+  std::size_t blockRows(std::size_t level) const noexcept {
+    return static_cast<std::size_t>(_levels[level].height + 3) / 4;
+  }
+
+  /* Decodes block rows [begin, end) of level into _decoded[level]. */
+  void decodeRows(std::size_t level, std::size_t begin,
+                  std::size_t end) noexcept {
+    const auto &info = _levels[level];
+    auto width = static_cast<std::size_t>(info.width);
+    auto height = static_cast<std::size_t>(info.height);
+    auto blocksX = (width + 3) / 4;
+    auto *output = _decoded[level].data();
+    for (std::size_t by = begin; by < end; ++by) {
+      for (std::size_t bx = 0; bx < blocksX; ++bx) {
+        auto *block = info.data.data() +
+                      (by * blocksX + bx) * _format.blockBytes;
+        std::uint8_t texels[16][4];
+        if (_transcode == Ktx2Transcode::Bc1) {
+          decodeBc1Colors(block, Bc1Mode::Opaque, texels);
+        } else if (_transcode == Ktx2Transcode::Bc1Alpha) {
+          decodeBc1Colors(block, Bc1Mode::PunchThrough, texels);
+        } else {
+          decodeBc1Colors(block + 8, Bc1Mode::FourColors, texels);
+          if (_transcode == Ktx2Transcode::Bc2) {
+            decodeBc2Alpha(block, texels);
+          } else {
+            decodeBc3Alpha(block, texels);
+          }
+        }
+        for (std::size_t y = 0; y < 4 && by * 4 + y < height; ++y) {
+          for (std::size_t x = 0; x < 4 && bx * 4 + x < width; ++x) {
+            auto pixel = (by * 4 + y) * width + bx * 4 + x;
+            std::memcpy(output + pixel * 4, texels[y * 4 + x], 4);
+          }
+        }
+      }
+    }
+  }
+
+  /* Without a pool the level is decoded by upload() instead. */
+  void startDecode(std::size_t level) noexcept {
+    const auto &info = _levels[level];
+    _decoded[level].resize(static_cast<std::size_t>(info.width) *
+                           static_cast<std::size_t>(info.height) * 4);
+    if (_pool == nullptr) {
+      return;
+    }
+    _decodes[level] = _pool->parallelFor(
+        blockRows(level), _decodeGrain,
+        [this, level](std::size_t begin, std::size_t end) {
+          decodeRows(level, begin, end);
+        });
+  }
+
+  VoidResult upload(std::size_t level) noexcept {
+    const auto &info = _levels[level];
+    auto textureId = _texture->id();
+    if (_transcode != Ktx2Transcode::None) {
+      if (_pool == nullptr) {
+        decodeRows(level, 0, blockRows(level));
+      } else {
+        // Helps with whatever is left; stream() only gets here once the
+        // workers are done, create() for the tiny smallest level.
+        _decodes[level].wait();
+      }
+      auto &decoded = _decoded[level];
+      CHECK_RESULT(GL::instance().textureSubImage2D(
+          textureId, static_cast<GLint>(level), 0, 0, info.width,
+          info.height, GL_RGBA, GL_UNSIGNED_BYTE, decoded.data(),
+          decoded.size()));
+      decoded = {};
+    } else if (_format.blockSize == 1) {
+      CHECK_RESULT(GL::instance().textureSubImage2D(
+          textureId, static_cast<GLint>(level), 0, 0, info.width,
+          info.height, GL_RGBA, GL_UNSIGNED_BYTE, info.data.data(),
+          info.data.size()));
+    } else {
+      CHECK_RESULT(GL::instance().compressedTextureSubImage2D(
+          textureId, static_cast<GLint>(level), 0, 0, info.width,
+          info.height, _format.internalFormat,
+          static_cast<GLsizei>(info.data.size()), info.data.data()));
+    }
+    _baseLevel = level;
+    return GL::instance().textureParameteri(
+        textureId, GL_TEXTURE_BASE_LEVEL, static_cast<GLint>(level));
+  }
+
+public:
+  Ktx2Texture(const Ktx2Texture &) = delete;
+  Ktx2Texture &operator=(const Ktx2Texture &) = delete;
+
+  static UniqueResult<Ktx2Texture>
+  create(const std::string &path, Ktx2TextureConfig config = {}) noexcept {
+    UNIQUE_RESULT(file, MappedFile::open(path));
+    auto bytes = file.bytes();
+    Ktx2Header header;
+    if (bytes.size() < sizeof(header)) {
+      return SimpleError("{} is too small for a KTX2 header", path);
+    }
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    if (header.identifier != KTX2_IDENTIFIER) {
+      return SimpleError("{} is not a KTX2 file", path);
+    }
+    if (header.supercompressionScheme != 0) {
+      return SimpleError("{} uses supercompression scheme {}, which is not "
+                         "supported; encode it without supercompression",
+                         path, header.supercompressionScheme);
+    }
+    if (header.pixelWidth == 0 || header.pixelHeight == 0 ||
+        header.pixelDepth > 1 || header.layerCount > 1 ||
+        header.faceCount != 1) {
+      return SimpleError("{} is not a single 2D texture: {}x{}x{}, {} layers, "
+                         "{} faces",
+                         path, header.pixelWidth, header.pixelHeight,
+                         header.pixelDepth, header.layerCount,
+                         header.faceCount);
+    }
+    auto format = std::ranges::find(KTX2_FORMATS, header.vkFormat,
+                                    &Ktx2Format::vkFormat);
+    if (format == std::ranges::end(KTX2_FORMATS)) {
+      return SimpleError("{} has unsupported VkFormat {}", path,
+                         header.vkFormat);
+    }
+
+    auto texture = std::unique_ptr<Ktx2Texture>(
+        new Ktx2Texture(std::move(file), *format, config));
+    AUTO_RESULT(levels, texture->parseLevels(header));
+    texture->_levels = std::move(levels);
+    auto levelCount = texture->_levels.size();
+    texture->_baseLevel = levelCount;
+
+    auto internalFormat = format->internalFormat;
+    AUTO_RESULT(supported, GL::instance().getInternalformati(
+                               GL_TEXTURE_2D, internalFormat,
+                               GL_INTERNALFORMAT_SUPPORTED));
+    if (supported != GL_TRUE) {
+      texture->_transcode = transcodeFor(internalFormat);
+      if (texture->_transcode == Ktx2Transcode::None) {
+        return SimpleError("{}: the driver does not support format {:#x}",
+                           path, internalFormat);
+      }
+      internalFormat = format->srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8;
+    }
+
+    UNIQUE_RESULT(storage,
+                  Texture::create2D(internalFormat,
+                                    static_cast<GLsizei>(header.pixelWidth),
+                                    static_cast<GLsizei>(header.pixelHeight),
+                                    static_cast<GLsizei>(levelCount)));
+    texture->_texture.emplace(std::move(storage));
+    auto textureId = texture->_texture->id();
+    CHECK_RESULT(GL::instance().textureParameteri(
+        textureId, GL_TEXTURE_MIN_FILTER,
+        levelCount > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR));
+    CHECK_RESULT(GL::instance().textureParameteri(
+        textureId, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(levelCount - 1)));
+
+    texture->_decoded.resize(levelCount);
+    texture->_decodes.resize(levelCount);
+    if (texture->_transcode != Ktx2Transcode::None) {
+      // Smallest first, so the pool's FIFO finishes levels in upload order.
+      for (auto level = levelCount; level-- > 0;) {
+        texture->startDecode(level);
+      }
+    }
+    CHECK_RESULT(texture->upload(levelCount - 1));
+    return texture;
+  }
+
+  const Texture &texture() const noexcept { return *_texture; }
+
+  GLsizei levels() const noexcept {
+    return static_cast<GLsizei>(_levels.size());
+  }
+
+  /* Largest level uploaded so far; 0 once streaming is complete. */
+  GLsizei baseLevel() const noexcept {
+    return static_cast<GLsizei>(_baseLevel);
+  }
+
+  bool complete() const noexcept { return _baseLevel == 0; }
+
+  /* True when the payload is decoded to RGBA8 because the driver lacks its
+   * compressed format. */
+  bool transcoded() const noexcept {
+    return _transcode != Ktx2Transcode::None;
+  }
+
+  /* Uploads the next larger levels until about budgetBytes were sent or the
+   * next level is still being decoded. At least one level is uploaded when
+   * one is ready, so a small budget still makes progress every call. */
+  VoidResult stream(std::size_t budgetBytes = std::size_t{1} << 20) noexcept {
+    std::size_t sent = 0;
+    while (_baseLevel > 0) {
+      auto level = _baseLevel - 1;
+      if (!_decodes[level].done()) {
+        return {};
+      }
+      CHECK_RESULT(upload(level));
+      sent += _levels[level].data.size();
+      if (sent >= budgetBytes) {
+        return {};
+      }
+    }
+    return {};
+  }
+};
+
+} // namespace na::gl
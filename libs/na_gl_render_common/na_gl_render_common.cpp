@@ -1,3 +1,21 @@
 export module na_gl_render_common;
 
+export import :camera;
+export import :file;
+export import :framebuffer;
+export import :gpu_layout;
+export import :gpu_timer;
+export import :hash;
+export import :ktx2_texture;
+export import :program_cache;
+export import :program_pipeline;
+export import :program_reflection;
+export import :render_target_pool;
 export import :shader;
+export import :shader_batch;
+export import :shader_pack;
+export import :shader_preprocessor;
+export import :shader_reloader;
+export import :shader_variants;
+export import :stream_buffer;
+export import :texture;
@@ -0,0 +1,291 @@
+module;
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <glad/glad.h>
+#include <na_error/macros.hpp>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+export module na_gl_render_common:program_cache;
+
+import na_error;
+import na_gl;
+import :file;
+import :hash;
+import :shader;
+
+namespace na::gl {
+
+export struct ShaderSource {
+  GLenum type;
+  std::string_view source;
+};
+
+export struct ProgramCacheStats {
+  std::size_t hits{};
+  std::size_t misses{};
+  /* Cached binaries the driver refused to load. */
+  std::size_t rejected{};
+};
+
+/* Persists linked program binaries keyed by the hash of their stage sources.
+ * The file is memory-mapped on open and only rewritten by flush(); it is
+ * ignored as a whole when the GL vendor, renderer or version changed. */
+export class ProgramCache {
+  static constexpr std::uint32_t MAGIC = 0x4350414e; // "NAPC"
+  static constexpr std::uint32_t VERSION = 2;
+
+  struct FileHeader {
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::uint64_t driverHash;
+    std::uint32_t entryCount;
+    std::uint32_t reserved;
+  };
+
+  struct EntryHeader {
+    std::uint64_t key;
+    std::uint64_t offset;
+    std::uint32_t format;
+    std::uint32_t size;
+  };
+
+  struct Entry {
+    GLenum format;
+    std::span<const std::byte> data;
+  };
+
+  struct PendingEntry {
+    std::uint64_t key;
+    ProgramBinary binary;
+  };
+
+  std::string _path;
+  std::uint64_t _driverHash;
+  std::optional<MappedFile> _mapping;
+  std::unordered_map<std::uint64_t, Entry> _entries;
+  std::vector<PendingEntry> _pending;
+  ProgramCacheStats _stats{};
+
+  ProgramCache(std::string path, std::uint64_t driverHash) noexcept
+      : _path(std::move(path)), _driverHash(driverHash) {}
+
+  void unmap() noexcept {
+    _entries.clear();
+    _mapping.reset();
+  }
+
+  /* Maps the cache file and indexes it; a missing, truncated or foreign file
+   * leaves the cache empty rather than failing. */
+  void map() noexcept {
+    unmap();
+    auto mapping = MappedFile::open(_path);
+    if (mapping.failed() ||
+        mapping.value().bytes().size() < sizeof(FileHeader)) {
+      return;
+    }
+    _mapping.emplace(std::move(mapping.value()));
+    auto bytes = _mapping->bytes();
+    auto size = bytes.size();
+
+    FileHeader header;
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    if (header.magic != MAGIC || header.version != VERSION ||
+        header.driverHash != _driverHash ||
+        sizeof(FileHeader) + header.entryCount * sizeof(EntryHeader) > size) {
+      unmap();
+      return;
+    }
+    for (std::uint32_t i = 0; i < header.entryCount; ++i) {
+      EntryHeader entry;
+      std::memcpy(&entry,
+                  bytes.data() + sizeof(FileHeader) + i * sizeof(entry),
+                  sizeof(entry));
+      // Compared without adding, so a corrupt offset cannot wrap around.
+      if (entry.offset > size || entry.size > size - entry.offset) {
+        continue;
+      }
+      _entries[entry.key] = Entry{
+          .format = entry.format,
+          .data = bytes.subspan(entry.offset, entry.size),
+      };
+    }
+  }
+
+public:
+  ProgramCache(const ProgramCache &) = delete;
+  ProgramCache &operator=(const ProgramCache &) = delete;
+  ProgramCache &operator=(ProgramCache &&) noexcept = delete;
+
+  ProgramCache(ProgramCache &&other) noexcept
+      : _path(std::move(other._path)), _driverHash(other._driverHash),
+        _mapping(std::move(other._mapping)),
+        _entries(std::move(other._entries)),
+        _pending(std::move(other._pending)), _stats(other._stats) {
+    other._mapping.reset();
+  }
+
+  ~ProgramCache() noexcept { unmap(); }
+
+  const ProgramCacheStats &stats() const noexcept { return _stats; }
+
+  static Result<ProgramCache> open(std::string path) noexcept {
+    AUTO_RESULT(binaryFormats,
+                GL::instance().getInteger(GL_NUM_PROGRAM_BINARY_FORMATS));
+    if (binaryFormats <= 0) {
+      return SimpleError("driver supports no program binary formats");
+    }
+    auto driverHash = HASH_SEED;
+    for (auto name : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+      AUTO_RESULT(value, GL::instance().getString(name));
+      driverHash = hashString(value, driverHash);
+    }
+    ProgramCache cache(std::move(path), driverHash);
+    cache.map();
+    return cache;
+  }
+
+  /* Options that change the linked program take part in the key. */
+  static std::uint64_t programKey(std::span<const ShaderSource> sources,
+                                  ProgramOptions options = {}) noexcept {
+    auto key = hashCombine(HASH_SEED, options.separable);
+    for (const auto &source : sources) {
+      key = hashCombine(key, source.type);
+      key = hashCombine(key, hashString(source.source));
+    }
+    return key;
+  }
+
+  /* Loads the cached binary for these sources, if any is usable. */
+  std::optional<ShaderProgram> restore(std::string name, std::uint64_t key,
+                                       ProgramOptions options = {}) noexcept {
+    auto it = _entries.find(key);
+    if (it == _entries.end()) {
+      _stats.misses++;
+      return std::nullopt;
+    }
+    auto program = ShaderProgram::createFromBinary(
+        it->second.format, it->second.data, std::move(name), options);
+    if (program.failed()) {
+      _stats.rejected++;
+      _stats.misses++;
+      _entries.erase(it);
+      return std::nullopt;
+    }
+    _stats.hits++;
+    return std::move(program.value());
+  }
+
+  /* Queues the binary of a program linked with retrievableBinary for the
+   * next flush(). */
+  void store(std::uint64_t key, const ShaderProgram &program) noexcept {
+    if (auto binary = program.binary(); binary.ok()) {
+      _pending.push_back({.key = key, .binary = std::move(binary.value())});
+    }
+  }
+
+  /* Restores the program from its cached binary, or compiles and links it
+   * from source when there is no usable binary. */
+  Result<ShaderProgram> getOrCreate(std::string name,
+                                    std::span<const ShaderSource> sources,
+                                    ProgramOptions options = {}) noexcept {
+    auto key = programKey(sources, options);
+    if (auto program = restore(name, key, options)) {
+      return std::move(*program);
+    }
+
+    std::vector<ShaderStage> stages;
+    stages.reserve(sources.size());
+    for (std::size_t i = 0; i < sources.size(); ++i) {
+      UNIQUE_RESULT(stage,
+                    ShaderStage::create(sources[i].type,
+                                        std::format("{}_{}", name, i),
+                                        sources[i].source));
+      stages.push_back(std::move(stage));
+    }
+    std::vector<const ShaderStage *> stagePointers;
+    for (const auto &stage : stages) {
+      stagePointers.push_back(&stage);
+    }
+    options.retrievableBinary = true;
+    UNIQUE_RESULT(program,
+                  ShaderProgram::create(stagePointers.begin(),
+                                        stagePointers.end(), std::move(name),
+                                        options));
+    store(key, program);
+    return program;
+  }
+
+  /* Rewrites the cache file with all known binaries and remaps it. */
+  VoidResult flush() noexcept {
+    if (_pending.empty()) {
+      return {};
+    }
+    struct Blob {
+      std::uint64_t key;
+      GLenum format;
+      std::span<const std::byte> data;
+    };
+    std::vector<Blob> blobs;
+    for (const auto &[key, entry] : _entries) {
+      blobs.push_back({key, entry.format, entry.data});
+    }
+    for (const auto &pending : _pending) {
+      if (!_entries.contains(pending.key)) {
+        blobs.push_back(
+            {pending.key, pending.binary.format, pending.binary.data});
+      }
+    }
+
+    FileHeader header{
+        .magic = MAGIC,
+        .version = VERSION,
+        .driverHash = _driverHash,
+        .entryCount = static_cast<std::uint32_t>(blobs.size()),
+        .reserved = 0,
+    };
+    std::vector<EntryHeader> entries;
+    std::uint64_t offset =
+        sizeof(FileHeader) + blobs.size() * sizeof(EntryHeader);
+    for (const auto &blob : blobs) {
+      entries.push_back({.key = blob.key,
+                         .offset = offset,
+                         .format = blob.format,
+                         .size = static_cast<std::uint32_t>(blob.data.size())});
+      offset += blob.data.size();
+    }
+
+    auto tmpPath = _path + ".tmp";
+    {
+      std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+      out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+      out.write(reinterpret_cast<const char *>(entries.data()),
+                static_cast<std::streamsize>(entries.size() *
+                                             sizeof(EntryHeader)));
+      for (const auto &blob : blobs) {
+        out.write(reinterpret_cast<const char *>(blob.data.data()),
+                  static_cast<std::streamsize>(blob.data.size()));
+      }
+      if (!out) {
+        return SimpleError("failed to write program cache {}", tmpPath);
+      }
+    }
+    if (std::rename(tmpPath.c_str(), _path.c_str()) != 0) {
+      return SimpleError("failed to replace program cache {}", _path);
+    }
+    _pending.clear();
+    map();
+    return {};
+  }
+};
+
+} // namespace na::gl
@@ -0,0 +1,123 @@
+module;
+
+#include <cstdint>
+#include <glad/glad.h>
+#include <memory>
+#include <na_error/macros.hpp>
+#include <unordered_map>
+
+export module na_gl_render_common:program_pipeline;
+
+import na_error;
+import na_gl;
+import :shader;
+
+namespace na::gl {
+
+/* Binds the stages of separable programs (see ProgramOptions::separable).
+ * glUseProgram takes precedence over pipelines, so useProgram(0) before
+ * binding one. */
+export class ProgramPipeline {
+  GLuint _id{};
+  ProgramPipeline(GLuint id) noexcept : _id(id) {}
+
+public:
+  ProgramPipeline(const ProgramPipeline &) = delete;
+  ProgramPipeline &operator=(const ProgramPipeline &) = delete;
+  ProgramPipeline &operator=(ProgramPipeline &&) noexcept = delete;
+
+  ProgramPipeline(ProgramPipeline &&other) noexcept : _id(other._id) {
+    other._id = 0;
+  }
+
+  ~ProgramPipeline() noexcept {
+    if (_id != 0) {
+      GL::instance().deleteProgramPipeline(_id);
+    }
+  }
+
+  GLuint id() const noexcept { return _id; }
+
+  VoidResult useStages(GLbitfield stages,
+                       const ShaderProgram &program) noexcept {
+    return GL::instance().useProgramStages(_id, stages, program.id());
+  }
+
+  VoidResult bind() const noexcept {
+    return GL::instance().bindProgramPipeline(_id);
+  }
+
+  static Result<ProgramPipeline> create() noexcept {
+    AUTO_RESULT(pipelineId, GL::instance().createProgramPipeline());
+    return ProgramPipeline(pipelineId);
+  }
+};
+
+/* Pipelines keyed by the generation of their vertex and fragment program,
+ * so a program recreated under a recycled GL id never meets a pipeline with
+ * the old stages attached. N vertex and M fragment programs cost N + M links
+ * and a pipeline per pair actually drawn with, instead of N x M monolithic
+ * links. */
+export class ProgramPipelineCache {
+  std::unordered_map<std::uint64_t, std::unique_ptr<ProgramPipeline>>
+      _pipelines;
+  GLuint _bound = 0;
+
+  static std::uint64_t key(const ShaderProgram &vertex,
+                           const ShaderProgram &fragment) noexcept {
+    return static_cast<std::uint64_t>(vertex.generation()) << 32 |
+           fragment.generation();
+  }
+
+public:
+  Result<const ProgramPipeline *> get(const ShaderProgram &vertex,
+                                      const ShaderProgram &fragment) noexcept {
+    auto pipelineKey = key(vertex, fragment);
+    if (auto it = _pipelines.find(pipelineKey); it != _pipelines.end()) {
+      return it->second.get();
+    }
+    // Inserted only once complete, so the map never holds a null entry.
+    UNIQUE_RESULT(created, ProgramPipeline::create());
+    CHECK_RESULT(created.useStages(GL_VERTEX_SHADER_BIT, vertex));
+    CHECK_RESULT(created.useStages(GL_FRAGMENT_SHADER_BIT, fragment));
+    auto inserted = _pipelines.emplace(
+        pipelineKey, std::make_unique<ProgramPipeline>(std::move(created)));
+    return inserted.first->second.get();
+  }
+
+  /* Binds the pipeline for the pair, skipping the call when it is already
+   * bound through this cache. */
+  VoidResult bind(const ShaderProgram &vertex,
+                  const ShaderProgram &fragment) noexcept {
+    AUTO_RESULT(pipeline, get(vertex, fragment));
+    if (pipeline->id() == _bound) {
+      return {};
+    }
+    CHECK_RESULT(pipeline->bind());
+    _bound = pipeline->id();
+    return {};
+  }
+
+  /* Forgets the bound pipeline after code outside the cache changed it. */
+  void invalidateBinding() noexcept { _bound = 0; }
+
+  /* Frees pipelines using a program that is about to be destroyed, e.g.
+   * when a hot reload replaces it. Stale entries are never matched again,
+   * so this only reclaims memory. */
+  void evict(const ShaderProgram &program) noexcept {
+    auto generation = program.generation();
+    std::erase_if(_pipelines, [generation, this](const auto &entry) {
+      auto vertex = static_cast<std::uint32_t>(entry.first >> 32);
+      auto fragment = static_cast<std::uint32_t>(entry.first & 0xffffffffu);
+      if (vertex != generation && fragment != generation) {
+        return false;
+      }
+      if (entry.second->id() == _bound) {
+        _bound = 0;
+      }
+      return true;
+    });
+  }
+};
+
+} // namespace na::gl
@@ -0,0 +1,362 @@
+module;
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <glad/glad.h>
+#include <na_error/macros.hpp>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+export module na_gl_render_common:program_reflection;
+
+import na_error;
+import na_gl;
+import :hash;
+
+namespace na::gl {
+
+export enum class ProgramResourceKind : std::uint8_t {
+  Uniform,
+  UniformBlock,
+  StorageBlock,
+  BufferVariable,
+};
+
+/* One active resource of a linked program. Fields that do not apply to the
+ * resource kind keep their defaults; offsets and strides are in bytes. */
+export struct ProgramResource {
+  std::uint64_t hash{};
+  std::string name;
+  ProgramResourceKind kind{};
+  GLenum type = GL_NONE;
+  GLint location = -1;
+  GLint arraySize = 0;
+  /* Index of the enclosing block, -1 for default-block uniforms. */
+  GLint blockIndex = -1;
+  GLint offset = -1;
+  GLint arrayStride = 0;
+  GLint matrixStride = 0;
+  GLint topLevelArrayStride = 0;
+  /* Blocks only. */
+  GLint binding = -1;
+  GLint dataSize = 0;
+};
+
+/* Byte size of one element of a uniform of the given type as uploaded by
+ * glProgramUniform*; samplers, images, ints and bools count as one int. */
+export constexpr std::size_t uniformTypeSize(GLenum type) noexcept {
+  switch (type) {
+  case GL_FLOAT_VEC2:
+  case GL_INT_VEC2:
+  case GL_UNSIGNED_INT_VEC2:
+  case GL_BOOL_VEC2:
+    return 8;
+  case GL_FLOAT_VEC3:
+  case GL_INT_VEC3:
+  case GL_UNSIGNED_INT_VEC3:
+  case GL_BOOL_VEC3:
+    return 12;
+  case GL_FLOAT_VEC4:
+  case GL_INT_VEC4:
+  case GL_UNSIGNED_INT_VEC4:
+  case GL_BOOL_VEC4:
+  case GL_FLOAT_MAT2:
+    return 16;
+  case GL_FLOAT_MAT3:
+    return 36;
+  case GL_FLOAT_MAT4:
+    return 64;
+  case GL_FLOAT_MAT2x3:
+  case GL_FLOAT_MAT3x2:
+    return 24;
+  case GL_FLOAT_MAT2x4:
+  case GL_FLOAT_MAT4x2:
+    return 32;
+  case GL_FLOAT_MAT3x4:
+  case GL_FLOAT_MAT4x3:
+    return 48;
+  case GL_DOUBLE:
+    return 8;
+  case GL_DOUBLE_VEC2:
+    return 16;
+  case GL_DOUBLE_VEC3:
+    return 24;
+  case GL_DOUBLE_MAT2x3:
+  case GL_DOUBLE_MAT3x2:
+    return 48;
+  case GL_DOUBLE_VEC4:
+  case GL_DOUBLE_MAT2:
+    return 32;
+  case GL_DOUBLE_MAT3:
+    return 72;
+  case GL_DOUBLE_MAT4:
+    return 128;
+  case GL_DOUBLE_MAT2x4:
+  case GL_DOUBLE_MAT4x2:
+    return 64;
+  case GL_DOUBLE_MAT3x4:
+  case GL_DOUBLE_MAT4x3:
+    return 96;
+  default:
+    return 4;
+  }
+}
+
+/* Link-time reflection of uniforms, uniform blocks, storage blocks and their
+ * members. Resources are kept in one flat table sorted by kind and name, with
+ * an open-addressed index over name hashes so lookups by a precomputed
+ * hashString() cost a probe or two instead of a string compare. */
+export class ProgramReflection {
+  static constexpr std::uint32_t EMPTY_SLOT = 0;
+
+  std::vector<ProgramResource> _resources;
+  /* Resource index + 1, EMPTY_SLOT when unused; size is a power of two. */
+  std::vector<std::uint32_t> _slots;
+
+  static std::uint64_t slotKey(ProgramResourceKind kind,
+                               std::uint64_t nameHash) noexcept {
+    return hashCombine(nameHash, static_cast<std::uint64_t>(kind));
+  }
+
+  /* GL reports arrays as "name[0]"; they are looked up by their bare name. */
+  static std::string lookupName(std::string name) noexcept {
+    if (name.ends_with("[0]")) {
+      name.resize(name.size() - 3);
+    }
+    return name;
+  }
+
+  VoidResult reflectInterface(GLuint program, GLenum interface,
+                              ProgramResourceKind kind,
+                              std::span<const GLenum> properties) noexcept {
+    AUTO_RESULT(count, GL::instance().getProgramInterfaceiv(
+                           program, interface, GL_ACTIVE_RESOURCES));
+    AUTO_RESULT(maxLength, GL::instance().getProgramInterfaceiv(
+                               program, interface, GL_MAX_NAME_LENGTH));
+    std::vector<GLint> values(properties.size());
+    for (GLint i = 0; i < count; ++i) {
+      auto index = static_cast<GLuint>(i);
+      AUTO_RESULT(name, GL::instance().getProgramResourceName(
+                            program, interface, index, maxLength));
+      CHECK_RESULT(GL::instance().getProgramResourceiv(
+          program, interface, index, properties, values));
+      ProgramResource resource;
+      resource.name = lookupName(std::move(name));
+      resource.kind = kind;
+      resource.hash = hashString(resource.name);
+      for (std::size_t p = 0; p < properties.size(); ++p) {
+        switch (properties[p]) {
+        case GL_TYPE:
+          resource.type = static_cast<GLenum>(values[p]);
+          break;
+        case GL_LOCATION:
+          resource.location = values[p];
+          break;
+        case GL_ARRAY_SIZE:
+          resource.arraySize = values[p];
+          break;
+        case GL_BLOCK_INDEX:
+          resource.blockIndex = values[p];
+          break;
+        case GL_OFFSET:
+          resource.offset = values[p];
+          break;
+        case GL_ARRAY_STRIDE:
+          resource.arrayStride = values[p];
+          break;
+        case GL_MATRIX_STRIDE:
+          resource.matrixStride = values[p];
+          break;
+        case GL_TOP_LEVEL_ARRAY_STRIDE:
+          resource.topLevelArrayStride = values[p];
+          break;
+        case GL_BUFFER_BINDING:
+          resource.binding = values[p];
+          break;
+        case GL_BUFFER_DATA_SIZE:
+          resource.dataSize = values[p];
+          break;
+        }
+      }
+      _resources.push_back(std::move(resource));
+    }
+    return {};
+  }
+
+  void buildIndex() noexcept {
+    std::ranges::sort(_resources, {}, [](const ProgramResource &resource) {
+      return std::tie(resource.kind, resource.name);
+    });
+    _slots.assign(std::bit_ceil(std::max<std::size_t>(_resources.size() * 2, 8)),
+                  EMPTY_SLOT);
+    auto mask = _slots.size() - 1;
+    for (std::size_t i = 0; i < _resources.size(); ++i) {
+      auto slot = slotKey(_resources[i].kind, _resources[i].hash) & mask;
+      while (_slots[slot] != EMPTY_SLOT) {
+        slot = (slot + 1) & mask;
+      }
+      _slots[slot] = static_cast<std::uint32_t>(i + 1);
+    }
+  }
+
+public:
+  static Result<ProgramReflection> reflect(GLuint program) noexcept {
+    static constexpr GLenum UNIFORM_PROPERTIES[] = {
+        GL_TYPE,   GL_LOCATION,     GL_ARRAY_SIZE,    GL_BLOCK_INDEX,
+        GL_OFFSET, GL_ARRAY_STRIDE, GL_MATRIX_STRIDE,
+    };
+    static constexpr GLenum BLOCK_PROPERTIES[] = {
+        GL_BUFFER_BINDING,
+        GL_BUFFER_DATA_SIZE,
+    };
+    static constexpr GLenum BUFFER_VARIABLE_PROPERTIES[] = {
+        GL_TYPE,         GL_ARRAY_SIZE,    GL_BLOCK_INDEX,
+        GL_OFFSET,       GL_ARRAY_STRIDE,  GL_MATRIX_STRIDE,
+        GL_TOP_LEVEL_ARRAY_STRIDE,
+    };
+    ProgramReflection reflection;
+    CHECK_RESULT(reflection.reflectInterface(
+        program, GL_UNIFORM, ProgramResourceKind::Uniform, UNIFORM_PROPERTIES));
+    CHECK_RESULT(reflection.reflectInterface(program, GL_UNIFORM_BLOCK,
+                                             ProgramResourceKind::UniformBlock,
+                                             BLOCK_PROPERTIES));
+    CHECK_RESULT(reflection.reflectInterface(program, GL_SHADER_STORAGE_BLOCK,
+                                             ProgramResourceKind::StorageBlock,
+                                             BLOCK_PROPERTIES));
+    CHECK_RESULT(reflection.reflectInterface(
+        program, GL_BUFFER_VARIABLE, ProgramResourceKind::BufferVariable,
+        BUFFER_VARIABLE_PROPERTIES));
+    reflection.buildIndex();
+    return reflection;
+  }
+
+  std::span<const ProgramResource> resources() const noexcept {
+    return _resources;
+  }
+
+  std::optional<std::size_t> indexOf(ProgramResourceKind kind,
+                                     std::uint64_t nameHash) const noexcept {
+    if (_slots.empty()) {
+      return std::nullopt;
+    }
+    auto mask = _slots.size() - 1;
+    for (auto slot = slotKey(kind, nameHash) & mask;
+         _slots[slot] != EMPTY_SLOT; slot = (slot + 1) & mask) {
+      const auto &resource = _resources[_slots[slot] - 1];
+      if (resource.hash == nameHash && resource.kind == kind) {
+        return _slots[slot] - 1;
+      }
+    }
+    return std::nullopt;
+  }
+
+  const ProgramResource *find(ProgramResourceKind kind,
+                              std::uint64_t nameHash) const noexcept {
+    auto index = indexOf(kind, nameHash);
+    return index ? &_resources[*index] : nullptr;
+  }
+
+  const ProgramResource *uniform(std::uint64_t nameHash) const noexcept {
+    return find(ProgramResourceKind::Uniform, nameHash);
+  }
+
+  const ProgramResource *uniformBlock(std::uint64_t nameHash) const noexcept {
+    return find(ProgramResourceKind::UniformBlock, nameHash);
+  }
+
+  const ProgramResource *storageBlock(std::uint64_t nameHash) const noexcept {
+    return find(ProgramResourceKind::StorageBlock, nameHash);
+  }
+
+  const ProgramResource *bufferVariable(std::uint64_t nameHash) const noexcept {
+    return find(ProgramResourceKind::BufferVariable, nameHash);
+  }
+};
+
+/* CPU shadow of a program's default-block uniforms. set() only marks a
+ * uniform dirty when its bytes change and flush() uploads the dirty ones with
+ * glProgramUniform*, so redundant uniform calls never reach the driver. */
+export class ProgramUniforms {
+  struct Slot {
+    std::uint32_t offset{};
+    std::uint32_t size{};
+    bool known = false;
+    bool dirty = false;
+  };
+
+  std::vector<std::byte> _shadow;
+  /* Parallel to ProgramReflection::resources(). */
+  std::vector<Slot> _slots;
+  std::vector<std::uint32_t> _dirty;
+
+public:
+  ProgramUniforms() noexcept = default;
+
+  explicit ProgramUniforms(const ProgramReflection &reflection) noexcept {
+    std::uint32_t offset = 0;
+    for (const auto &resource : reflection.resources()) {
+      Slot slot{};
+      if (resource.kind == ProgramResourceKind::Uniform &&
+          resource.location >= 0) {
+        slot.offset = offset;
+        slot.size = static_cast<std::uint32_t>(
+            uniformTypeSize(resource.type) *
+            static_cast<std::size_t>(std::max(resource.arraySize, 1)));
+        offset += slot.size;
+      }
+      _slots.push_back(slot);
+    }
+    _shadow.resize(offset);
+  }
+
+  /* Uniforms the linker optimized away are silently ignored. */
+  VoidResult set(const ProgramReflection &reflection, std::uint64_t nameHash,
+                 std::span<const std::byte> value) noexcept {
+    auto index = reflection.indexOf(ProgramResourceKind::Uniform, nameHash);
+    if (!index || _slots[*index].size == 0) {
+      return {};
+    }
+    auto &slot = _slots[*index];
+    if (value.size() > slot.size) {
+      return SimpleError("uniform {} holds {} bytes, got {}",
+                         reflection.resources()[*index].name, slot.size,
+                         value.size());
+    }
+    auto *shadow = _shadow.data() + slot.offset;
+    if (slot.known && std::memcmp(shadow, value.data(), value.size()) == 0) {
+      return {};
+    }
+    std::memcpy(shadow, value.data(), value.size());
+    slot.known = true;
+    if (!slot.dirty) {
+      slot.dirty = true;
+      _dirty.push_back(static_cast<std::uint32_t>(*index));
+    }
+    return {};
+  }
+
+  bool dirty() const noexcept { return !_dirty.empty(); }
+
+  VoidResult flush(const ProgramReflection &reflection,
+                   GLuint program) noexcept {
+    for (auto index : _dirty) {
+      auto &slot = _slots[index];
+      const auto &uniform = reflection.resources()[index];
+      slot.dirty = false;
+      CHECK_RESULT(GL::instance().programUniform(
+          program, uniform.location, uniform.type,
+          std::max(uniform.arraySize, 1), _shadow.data() + slot.offset));
+    }
+    _dirty.clear();
+    return {};
+  }
+};
+
+} // namespace na::gl
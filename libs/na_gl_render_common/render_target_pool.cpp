@@ -0,0 +1,251 @@
+module;
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <glad/glad.h>
+#include <memory>
+#include <na_error/macros.hpp>
+#include <optional>
+#include <span>
+#include <vector>
+
+export module na_gl_render_common:render_target_pool;
+
+import na_error;
+import na_gl;
+import :framebuffer;
+import :texture;
+
+namespace na::gl {
+
+export struct RenderTargetDesc {
+  GLsizei width;
+  GLsizei height;
+  GLenum format;
+
+  bool operator==(const RenderTargetDesc &) const noexcept = default;
+};
+
+export struct RenderTarget {
+  GLuint texture{};
+  RenderTargetDesc desc{};
+  std::uint32_t slot{};
+};
+
+export struct RenderTargetPoolConfig {
+  /* Upper bound for all textures owned by the pool. */
+  std::size_t budgetBytes = std::size_t{256} << 20;
+  /* Targets untouched for this many frames are destroyed, so targets sized
+   * for an old window size do not linger after a resize. */
+  std::uint64_t maxIdleFrames = 3;
+};
+
+export struct RenderTargetPoolStats {
+  /* Bytes currently allocated by the pool across all frames. */
+  std::size_t allocatedBytes{};
+  /* Bytes of distinct textures handed out during the current frame. */
+  std::size_t frameBytes{};
+  /* Bytes the current frame would have needed without aliasing. */
+  std::size_t requestedBytes{};
+  std::size_t peakFrameBytes{};
+  std::size_t targetCount{};
+  std::size_t framebufferCount{};
+  std::size_t allocationsThisFrame{};
+};
+
+/* Hands out transient color/depth targets. Releasing a target makes its
+ * texture available to later passes of the same frame, so passes whose
+ * lifetimes do not overlap alias the same memory. Everything still acquired is
+ * returned to the pool by the next beginFrame(). */
+export class RenderTargetPool {
+  static constexpr std::size_t MAX_COLOR_ATTACHMENTS = 4;
+
+  struct Slot {
+    std::optional<Texture> texture;
+    RenderTargetDesc desc{};
+    std::size_t bytes{};
+    std::uint64_t lastUsedFrame{};
+    bool inUse{};
+  };
+
+  struct CachedFramebuffer {
+    std::array<GLuint, MAX_COLOR_ATTACHMENTS + 1> attachments;
+    Framebuffer framebuffer;
+  };
+
+  RenderTargetPoolConfig _config;
+  std::vector<Slot> _slots;
+  std::vector<std::unique_ptr<CachedFramebuffer>> _framebuffers;
+  RenderTargetPoolStats _stats{};
+  std::uint64_t _frame = 1;
+
+  void destroySlot(Slot &slot) noexcept {
+    auto textureId = slot.texture->id();
+    std::erase_if(_framebuffers, [textureId](const auto &cached) {
+      return std::ranges::find(cached->attachments, textureId) !=
+             cached->attachments.end();
+    });
+    _stats.allocatedBytes -= slot.bytes;
+    slot.texture.reset();
+    slot.inUse = false;
+    _stats.targetCount--;
+    _stats.framebufferCount = _framebuffers.size();
+  }
+
+  VoidResult makeRoom(std::size_t bytes) noexcept {
+    while (_stats.allocatedBytes + bytes > _config.budgetBytes) {
+      Slot *victim = nullptr;
+      for (auto &slot : _slots) {
+        if (slot.texture && !slot.inUse &&
+            (victim == nullptr || slot.lastUsedFrame < victim->lastUsedFrame)) {
+          victim = &slot;
+        }
+      }
+      if (victim == nullptr) {
+        return SimpleError("render target budget exceeded: {} + {} > {} bytes",
+                           _stats.allocatedBytes, bytes, _config.budgetBytes);
+      }
+      destroySlot(*victim);
+    }
+    return {};
+  }
+
+  void markUsed(std::uint32_t index) noexcept {
+    auto &slot = _slots[index];
+    if (slot.lastUsedFrame != _frame) {
+      _stats.frameBytes += slot.bytes;
+      _stats.peakFrameBytes =
+          std::max(_stats.peakFrameBytes, _stats.frameBytes);
+    }
+    slot.lastUsedFrame = _frame;
+    slot.inUse = true;
+  }
+
+public:
+  explicit RenderTargetPool(RenderTargetPoolConfig config = {}) noexcept
+      : _config(config) {}
+
+  RenderTargetPool(const RenderTargetPool &) = delete;
+  RenderTargetPool &operator=(const RenderTargetPool &) = delete;
+
+  const RenderTargetPoolStats &stats() const noexcept { return _stats; }
+
+  void beginFrame() noexcept {
+    ++_frame;
+    for (auto &slot : _slots) {
+      slot.inUse = false;
+      if (slot.texture && slot.lastUsedFrame + _config.maxIdleFrames < _frame) {
+        destroySlot(slot);
+      }
+    }
+    _stats.frameBytes = 0;
+    _stats.requestedBytes = 0;
+    _stats.allocationsThisFrame = 0;
+  }
+
+  Result<RenderTarget> acquire(const RenderTargetDesc &desc) noexcept {
+    auto bytes = static_cast<std::size_t>(desc.width) *
+                 static_cast<std::size_t>(desc.height) *
+                 textureFormatBytesPerPixel(desc.format);
+    if (bytes == 0) {
+      return SimpleError("unsupported render target {}x{} format={}",
+                         desc.width, desc.height, desc.format);
+    }
+    _stats.requestedBytes += bytes;
+
+    // Prefer textures already touched this frame: reusing them keeps the
+    // frame footprint at the peak of overlapping lifetimes.
+    std::optional<std::uint32_t> match;
+    for (std::uint32_t i = 0; i < _slots.size(); ++i) {
+      const auto &slot = _slots[i];
+      if (!slot.texture || slot.inUse || slot.desc != desc) {
+        continue;
+      }
+      if (slot.lastUsedFrame == _frame) {
+        match = i;
+        break;
+      }
+      if (!match) {
+        match = i;
+      }
+    }
+
+    if (!match) {
+      CHECK_RESULT(makeRoom(bytes));
+      UNIQUE_RESULT(texture,
+                    Texture::create2D(desc.format, desc.width, desc.height));
+      auto freeSlot = std::ranges::find_if(
+          _slots, [](const Slot &slot) { return !slot.texture; });
+      if (freeSlot == _slots.end()) {
+        _slots.emplace_back();
+        freeSlot = _slots.end() - 1;
+      }
+      freeSlot->texture.emplace(std::move(texture));
+      freeSlot->desc = desc;
+      freeSlot->bytes = bytes;
+      freeSlot->lastUsedFrame = 0;
+      match = static_cast<std::uint32_t>(freeSlot - _slots.begin());
+      _stats.allocatedBytes += bytes;
+      _stats.allocationsThisFrame++;
+      _stats.targetCount++;
+    }
+
+    markUsed(*match);
+    return RenderTarget{
+        .texture = _slots[*match].texture->id(),
+        .desc = desc,
+        .slot = *match,
+    };
+  }
+
+  /* Returns the target to the pool; later acquires this frame may alias it. */
+  void release(const RenderTarget &target) noexcept {
+    if (target.slot < _slots.size() && _slots[target.slot].texture &&
+        _slots[target.slot].texture->id() == target.texture) {
+      _slots[target.slot].inUse = false;
+    }
+  }
+
+  /* Returns a cached framebuffer with the given attachments. Framebuffers are
+   * destroyed together with the textures they reference. */
+  Result<const Framebuffer *> framebuffer(std::span<const RenderTarget> colors,
+                                          const RenderTarget *depth) noexcept {
+    if (colors.size() > MAX_COLOR_ATTACHMENTS) {
+      return SimpleError("too many color attachments: {}", colors.size());
+    }
+    std::array<GLuint, MAX_COLOR_ATTACHMENTS + 1> attachments{};
+    for (std::size_t i = 0; i < colors.size(); ++i) {
+      attachments[i] = colors[i].texture;
+    }
+    attachments[MAX_COLOR_ATTACHMENTS] = depth ? depth->texture : 0;
+
+    for (const auto &cached : _framebuffers) {
+      if (cached->attachments == attachments) {
+        return &cached->framebuffer;
+      }
+    }
+
+    UNIQUE_RESULT(framebuffer, Framebuffer::create());
+    for (std::size_t i = 0; i < colors.size(); ++i) {
+      CHECK_RESULT(framebuffer.attach(
+          GL_COLOR_ATTACHMENT0 + static_cast<GLenum>(i), colors[i].texture));
+    }
+    if (depth) {
+      auto attachment = isDepthStencilFormat(depth->desc.format)
+                            ? GL_DEPTH_STENCIL_ATTACHMENT
+                            : GL_DEPTH_ATTACHMENT;
+      CHECK_RESULT(framebuffer.attach(attachment, depth->texture));
+    }
+    CHECK_RESULT(framebuffer.setDrawBuffers(static_cast<GLsizei>(colors.size())));
+    CHECK_RESULT(framebuffer.checkComplete());
+
+    _framebuffers.push_back(std::make_unique<CachedFramebuffer>(
+        attachments, std::move(framebuffer)));
+    _stats.framebufferCount = _framebuffers.size();
+    return &_framebuffers.back()->framebuffer;
+  }
+};
+
+} // namespace na::gl
@@ -1,14 +1,21 @@
 module;
 
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
 #include <glad/glad.h>
 #include <na_error/macros.hpp>
+#include <span>
 #include <string>
 #include <string_view>
+#include <type_traits>
+#include <vector>
 
 export module na_gl_render_common:shader;
 
 import na_error;
 import na_gl;
+import :program_reflection;
 
 namespace na::gl {
 
@@ -37,12 +44,34 @@ public:
 
   static Result<ShaderStage> create(GLenum type, std::string name,
                                     std::string_view source) noexcept {
+    UNIQUE_RESULT(stage, createDeferred(type, std::move(name), source));
+    CHECK_RESULT(stage.compileStatus());
+    return stage;
+  }
+
+  /* Submits the compile without waiting for it; poll compileCompleted() and
+   * then check compileStatus(). */
+  static Result<ShaderStage> createDeferred(GLenum type, std::string name,
+                                            std::string_view source) noexcept {
     AUTO_RESULT(shaderId, GL::instance().createShader(type));
+    ShaderStage stage(shaderId, std::move(name));
     GLint sourceLens[] = {static_cast<GLint>(source.size())};
     const GLchar *sources[] = {source.data()};
     CHECK_RESULT(GL::instance().shaderSource(shaderId, 1, sources, sourceLens));
-    CHECK_RESULT(GL::instance().compileShader(shaderId));
-    return ShaderStage(shaderId, std::move(name));
+    CHECK_RESULT(GL::instance().startCompileShader(shaderId));
+    return stage;
+  }
+
+  bool compileCompleted() const noexcept {
+    return GL::instance().shaderCompletionStatus(_id);
+  }
+
+  VoidResult compileStatus() const noexcept {
+    if (auto result = GL::instance().shaderCompileStatus(_id);
+        result.failed()) {
+      return result.errorWithPrefix("shader {}", _name);
+    }
+    return {};
   }
 
   VoidResult attachToProgram(GLuint programId) const noexcept {
@@ -50,11 +79,39 @@ public:
   }
 };
 
+export struct ProgramOptions {
+  /* Asks the driver to keep the linked binary for glGetProgramBinary. */
+  bool retrievableBinary = false;
+  /* Links with GL_PROGRAM_SEPARABLE so the program can supply individual
+   * stages of a ProgramPipeline. */
+  bool separable = false;
+};
+
+export struct ProgramBinary {
+  GLenum format;
+  std::vector<std::byte> data;
+};
+
 export class ShaderProgram {
   GLuint _id{};
+  std::uint32_t _generation{};
   std::string _name{};
+  ProgramReflection _reflection{};
+  ProgramUniforms _uniforms{};
   ShaderProgram(GLuint id, std::string name) noexcept
-      : _id(id), _name(std::move(name)) {}
+      : _id(id), _generation(nextGeneration()), _name(std::move(name)) {}
+
+  static std::uint32_t nextGeneration() noexcept {
+    static std::atomic<std::uint32_t> generation{0};
+    return generation.fetch_add(1, std::memory_order_relaxed) + 1;
+  }
+
+  VoidResult reflect() noexcept {
+    AUTO_RESULT(reflection, ProgramReflection::reflect(_id));
+    _reflection = std::move(reflection);
+    _uniforms = ProgramUniforms(_reflection);
+    return {};
+  }
 
 public:
   ShaderProgram(const ShaderProgram &) = delete;
@@ -62,7 +119,10 @@ public:
   ShaderProgram &operator=(ShaderProgram &&) noexcept = delete;
 
   ShaderProgram(ShaderProgram &&other) noexcept
-      : _id(other._id), _name(std::move(other._name)) {
+      : _id(other._id), _generation(other._generation),
+        _name(std::move(other._name)),
+        _reflection(std::move(other._reflection)),
+        _uniforms(std::move(other._uniforms)) {
     other._id = 0;
   }
 
@@ -74,21 +134,115 @@ public:
 
   std::string_view name() const noexcept { return {_name}; }
 
+  GLuint id() const noexcept { return _id; }
+
+  /* Unlike id(), which the driver hands out again after glDeleteProgram,
+   * never repeats within a run; keys caches of per-program GL objects. */
+  std::uint32_t generation() const noexcept { return _generation; }
+
+  /* Filled in once linkStatus() succeeded or the program was restored from
+   * a binary. */
+  const ProgramReflection &reflection() const noexcept { return _reflection; }
+
+  VoidResult setUniform(std::uint64_t nameHash,
+                        std::span<const std::byte> value) noexcept {
+    return _uniforms.set(_reflection, nameHash, value);
+  }
+
+  template <typename T>
+    requires std::is_trivially_copyable_v<T>
+  VoidResult setUniform(std::uint64_t nameHash, const T &value) noexcept {
+    return setUniform(nameHash, std::as_bytes(std::span(&value, 1)));
+  }
+
+  /* Uploads the uniforms changed since the last flush. */
+  VoidResult flushUniforms() noexcept {
+    if (!_uniforms.dirty()) {
+      return {};
+    }
+    return _uniforms.flush(_reflection, _id);
+  }
+
+  Result<ProgramBinary> binary() const noexcept {
+    AUTO_RESULT(length,
+                GL::instance().getProgramiv(_id, GL_PROGRAM_BINARY_LENGTH));
+    if (length <= 0) {
+      return SimpleError("program {} has no retrievable binary", _name);
+    }
+    ProgramBinary binary{.format = GL_NONE,
+                         .data = std::vector<std::byte>(length)};
+    CHECK_RESULT(GL::instance().getProgramBinary(_id, length, &binary.format,
+                                                 binary.data.data()));
+    return binary;
+  }
+
   template <typename TIt>
-  static Result<ShaderProgram> create(TIt begin, TIt end,
-                                      std::string name) noexcept {
+  static Result<ShaderProgram> create(TIt begin, TIt end, std::string name,
+                                      ProgramOptions options = {}) noexcept {
+    UNIQUE_RESULT(program,
+                  createDeferred(begin, end, std::move(name), options));
+    CHECK_RESULT(program.linkStatus());
+    return program;
+  }
+
+  /* Like create(), but only starts the link; stages may still be compiling.
+   * Poll linkCompleted() and then check linkStatus(). */
+  template <typename TIt>
+  static Result<ShaderProgram> createDeferred(TIt begin, TIt end,
+                                              std::string name,
+                                              ProgramOptions options = {}) noexcept {
     AUTO_RESULT(programId, GL::instance().createProgram());
+    ShaderProgram program(programId, std::move(name));
+    if (options.retrievableBinary) {
+      CHECK_RESULT(GL::instance().programParameteri(
+          programId, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE));
+    }
+    if (options.separable) {
+      CHECK_RESULT(GL::instance().programParameteri(
+          programId, GL_PROGRAM_SEPARABLE, GL_TRUE));
+    }
     for (auto it = begin; it != end; ++it) {
       CHECK_RESULT((*it)->attachToProgram(programId));
     }
-    CHECK_RESULT(GL::instance().linkProgram(programId));
-    return ShaderProgram(programId, std::move(name));
+    CHECK_RESULT(GL::instance().startLinkProgram(programId));
+    return program;
+  }
+
+  bool linkCompleted() const noexcept {
+    return GL::instance().programCompletionStatus(_id);
+  }
+
+  /* Checks the link and reflects the program on success. */
+  VoidResult linkStatus() noexcept {
+    if (auto result = GL::instance().programLinkStatus(_id); result.failed()) {
+      return result.errorWithPrefix("program {}", _name);
+    }
+    if (_reflection.resources().empty()) {
+      CHECK_RESULT(reflect());
+    }
+    return {};
   }
 
   template <typename T>
   static Result<ShaderProgram> create(std::initializer_list<T *> stages,
-                                      std::string name) noexcept {
-    return create(stages.begin(), stages.end(), std::move(name));
+                                      std::string name,
+                                      ProgramOptions options = {}) noexcept {
+    return create(stages.begin(), stages.end(), std::move(name), options);
+  }
+
+  static Result<ShaderProgram>
+  createFromBinary(GLenum format, std::span<const std::byte> binary,
+                   std::string name, ProgramOptions options = {}) noexcept {
+    AUTO_RESULT(programId, GL::instance().createProgram());
+    ShaderProgram program(programId, std::move(name));
+    if (options.separable) {
+      CHECK_RESULT(GL::instance().programParameteri(
+          programId, GL_PROGRAM_SEPARABLE, GL_TRUE));
+    }
+    CHECK_RESULT(GL::instance().programBinary(
+        programId, format, binary.data(), static_cast<GLsizei>(binary.size())));
+    CHECK_RESULT(program.reflect());
+    return program;
   }
 };
 
@@ -0,0 +1,160 @@
+module;
+
+#include <cstddef>
+#include <cstdint>
+#include <format>
+#include <glad/glad.h>
+#include <memory>
+#include <na_error/macros.hpp>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+export module na_gl_render_common:shader_batch;
+
+import na_error;
+import na_gl;
+import :program_cache;
+import :shader;
+
+namespace na::gl {
+
+struct ProgramFutureState {
+  std::optional<Result<ShaderProgram>> result;
+};
+
+/* Handle to a program that is still compiling. It becomes ready once
+ * ShaderBatch::poll() observed the driver finishing the link. */
+export class ProgramFuture {
+  std::shared_ptr<ProgramFutureState> _state;
+
+public:
+  ProgramFuture() noexcept = default;
+  explicit ProgramFuture(std::shared_ptr<ProgramFutureState> state) noexcept
+      : _state(std::move(state)) {}
+
+  bool valid() const noexcept { return _state != nullptr; }
+
+  bool ready() const noexcept { return _state && _state->result.has_value(); }
+
+  /* Moves the program out; only valid once ready() returns true. */
+  Result<ShaderProgram> take() noexcept {
+    if (!ready()) {
+      return SimpleError("program is not ready");
+    }
+    auto result = std::move(*_state->result);
+    _state.reset();
+    return result;
+  }
+};
+
+/* Compiles many programs at once. add() submits every stage compile and the
+ * link without querying any status, so drivers implementing
+ * KHR_parallel_shader_compile work on all of them concurrently; poll() once
+ * per frame resolves the futures whose link completed. */
+export class ShaderBatch {
+  struct Pending {
+    std::vector<ShaderStage> stages;
+    std::optional<ShaderProgram> program;
+    std::uint64_t cacheKey{};
+    std::shared_ptr<ProgramFutureState> state;
+  };
+
+  ProgramCache *_cache;
+  std::vector<std::unique_ptr<Pending>> _pending;
+  bool _parallel;
+
+  void resolve(Pending &pending) noexcept {
+    auto &program = *pending.program;
+    if (auto status = program.linkStatus(); status.failed()) {
+      // The link log usually only says a stage failed; report the stage log.
+      for (const auto &stage : pending.stages) {
+        if (auto stageStatus = stage.compileStatus(); stageStatus.failed()) {
+          pending.state->result.emplace(stageStatus.error());
+          return;
+        }
+      }
+      pending.state->result.emplace(status.error());
+      return;
+    }
+    if (_cache != nullptr) {
+      _cache->store(pending.cacheKey, program);
+    }
+    pending.state->result.emplace(std::move(program));
+  }
+
+public:
+  /* The cache is optional; when given, cached binaries resolve immediately
+   * and freshly linked programs are queued for its next flush(). */
+  explicit ShaderBatch(ProgramCache *cache = nullptr) noexcept
+      : _cache(cache),
+        _parallel(GL::instance().maxShaderCompilerThreads(0xffffffffu)) {}
+
+  ShaderBatch(const ShaderBatch &) = delete;
+  ShaderBatch &operator=(const ShaderBatch &) = delete;
+
+  bool parallel() const noexcept { return _parallel; }
+
+  std::size_t pendingCount() const noexcept { return _pending.size(); }
+
+  bool done() const noexcept { return _pending.empty(); }
+
+  ProgramFuture add(std::string name, std::span<const ShaderSource> sources,
+                    ProgramOptions options = {}) noexcept {
+    auto state = std::make_shared<ProgramFutureState>();
+    ProgramFuture future(state);
+
+    auto cacheKey = ProgramCache::programKey(sources, options);
+    if (_cache != nullptr) {
+      if (auto program = _cache->restore(name, cacheKey, options)) {
+        state->result.emplace(std::move(*program));
+        return future;
+      }
+      options.retrievableBinary = true;
+    }
+
+    auto pending = std::make_unique<Pending>();
+    pending->cacheKey = cacheKey;
+    pending->state = state;
+    pending->stages.reserve(sources.size());
+    for (std::size_t i = 0; i < sources.size(); ++i) {
+      auto stage = ShaderStage::createDeferred(
+          sources[i].type, std::format("{}_{}", name, i), sources[i].source);
+      if (stage.failed()) {
+        state->result.emplace(stage.errorWithPrefix("program {}", name));
+        return future;
+      }
+      pending->stages.push_back(std::move(stage.value()));
+    }
+
+    std::vector<const ShaderStage *> stagePointers;
+    for (const auto &stage : pending->stages) {
+      stagePointers.push_back(&stage);
+    }
+    auto program = ShaderProgram::createDeferred(
+        stagePointers.begin(), stagePointers.end(), std::move(name), options);
+    if (program.failed()) {
+      state->result.emplace(program.error());
+      return future;
+    }
+    pending->program.emplace(std::move(program.value()));
+    _pending.push_back(std::move(pending));
+    return future;
+  }
+
+  /* Resolves every program whose link finished and returns how many are
+   * still compiling. Never blocks on drivers with parallel compilation. */
+  std::size_t poll() noexcept {
+    std::erase_if(_pending, [this](const std::unique_ptr<Pending> &pending) {
+      if (!pending->program->linkCompleted()) {
+        return false;
+      }
+      resolve(*pending);
+      return true;
+    });
+    return _pending.size();
+  }
+};
+
+} // namespace na::gl
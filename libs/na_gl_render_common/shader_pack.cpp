@@ -0,0 +1,74 @@
+module;
+
+#include <cstdint>
+#include <glad/glad.h>
+#include <span>
+#include <string_view>
+
+export module na_gl_render_common:shader_pack;
+
+import na_error;
+import :hash;
+import :program_cache;
+
+namespace na::gl {
+
+/* A shader in a pack generated by na_add_shader_pack(). */
+export struct ShaderPackEntry {
+  std::string_view name;
+  std::uint64_t nameHash;
+  /* Includes are already inlined; #line source N refers to
+   * dependencies[N - 1]. */
+  std::string_view source;
+  std::uint64_t sourceHash;
+  std::span<const std::string_view> dependencies;
+
+  static constexpr ShaderPackEntry
+  make(std::string_view name, std::string_view source,
+       std::span<const std::string_view> dependencies) noexcept {
+    return {.name = name,
+            .nameHash = hashString(name),
+            .source = source,
+            .sourceHash = hashString(source),
+            .dependencies = dependencies};
+  }
+};
+
+/* Index over shader sources embedded in the binary. Everything is built at
+ * compile time, so looking up a shader allocates nothing and opens no file. */
+export class ShaderPack {
+  std::span<const ShaderPackEntry> _entries;
+
+public:
+  constexpr explicit ShaderPack(
+      std::span<const ShaderPackEntry> entries) noexcept
+      : _entries(entries) {}
+
+  constexpr std::span<const ShaderPackEntry> entries() const noexcept {
+    return _entries;
+  }
+
+  constexpr const ShaderPackEntry *find(std::uint64_t nameHash) const noexcept {
+    for (const auto &entry : _entries) {
+      if (entry.nameHash == nameHash) {
+        return &entry;
+      }
+    }
+    return nullptr;
+  }
+
+  constexpr const ShaderPackEntry *find(std::string_view name) const noexcept {
+    return find(hashString(name));
+  }
+
+  Result<ShaderSource> source(GLenum type,
+                              std::string_view name) const noexcept {
+    const auto *entry = find(name);
+    if (entry == nullptr) {
+      return SimpleError("shader {} is not in the pack", name);
+    }
+    return ShaderSource{.type = type, .source = entry->source};
+  }
+};
+
+} // namespace na::gl
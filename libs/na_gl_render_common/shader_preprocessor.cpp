@@ -0,0 +1,165 @@
+module;
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <format>
+#include <functional>
+#include <na_error/macros.hpp>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+export module na_gl_render_common:shader_preprocessor;
+
+import na_error;
+import :file;
+import :hash;
+
+namespace na::gl {
+
+export using ShaderIncludeResolver =
+    std::function<Result<std::string>(std::string_view path)>;
+
+export struct PreprocessedShader {
+  std::string source;
+  std::uint64_t hash;
+  /* Included files in first-include order; source string N of #line
+   * directives refers to dependencies[N - 1], 0 is the root source. */
+  std::vector<std::string> dependencies;
+};
+
+/* Resolves #include "file" directives (each file is included once) and
+ * injects #define lines right after #version. Defines whose name does not
+ * occur in the expanded source are skipped, so permutations that only differ
+ * in bits a shader ignores produce identical text and hash. */
+export class ShaderPreprocessor {
+  static constexpr std::size_t MAX_INCLUDE_DEPTH = 32;
+
+  ShaderIncludeResolver _resolver;
+
+  static std::string_view trimLeft(std::string_view text) noexcept {
+    auto start = text.find_first_not_of(" \t");
+    return start == std::string_view::npos ? std::string_view{}
+                                           : text.substr(start);
+  }
+
+  VoidResult expand(std::string_view source, std::size_t sourceIndex,
+                    PreprocessedShader &out,
+                    std::vector<std::string> &stack) const noexcept {
+    if (stack.size() > MAX_INCLUDE_DEPTH) {
+      return SimpleError("includes nested deeper than {}", MAX_INCLUDE_DEPTH);
+    }
+    std::size_t lineNumber = 0;
+    while (!source.empty()) {
+      auto end = source.find('\n');
+      auto line = source.substr(0, end);
+      source = end == std::string_view::npos ? std::string_view{}
+                                             : source.substr(end + 1);
+      ++lineNumber;
+
+      auto directive = trimLeft(line);
+      if (!directive.starts_with("#include")) {
+        out.source.append(line);
+        out.source.push_back('\n');
+        continue;
+      }
+      auto argument = trimLeft(directive.substr(8));
+      auto close = argument.empty()
+                       ? std::string_view::npos
+                       : argument.find(argument[0] == '<' ? '>' : '"', 1);
+      if (close == std::string_view::npos ||
+          (argument[0] != '"' && argument[0] != '<')) {
+        return SimpleError("{}:{}: malformed #include", stack.back(),
+                           lineNumber);
+      }
+      auto path = std::string(argument.substr(1, close - 1));
+      if (std::ranges::find(stack, path) != stack.end()) {
+        return SimpleError("{}:{}: include cycle through {}", stack.back(),
+                           lineNumber, path);
+      }
+      if (std::ranges::find(out.dependencies, path) != out.dependencies.end()) {
+        out.source.push_back('\n');
+        continue;
+      }
+      if (!_resolver) {
+        return SimpleError("{}:{}: no include resolver for {}", stack.back(),
+                           lineNumber, path);
+      }
+      auto included = _resolver(path);
+      if (included.failed()) {
+        return included.errorWithPrefix("{}:{}", stack.back(), lineNumber);
+      }
+      out.dependencies.push_back(path);
+      out.source += std::format("#line 1 {}\n", out.dependencies.size());
+      stack.push_back(path);
+      CHECK_RESULT(
+          expand(included.value(), out.dependencies.size(), out, stack));
+      stack.pop_back();
+      out.source += std::format("#line {} {}\n", lineNumber + 1, sourceIndex);
+    }
+    return {};
+  }
+
+  static void injectDefines(std::string &source,
+                            std::span<const std::string> defines) noexcept {
+    std::string block;
+    for (const auto &define : defines) {
+      if (source.find(define) != std::string::npos) {
+        block += std::format("#define {} 1\n", define);
+      }
+    }
+    if (block.empty()) {
+      return;
+    }
+    std::size_t insertAt = 0;
+    std::size_t versionLine = 0;
+    if (auto version = source.find("#version"); version != std::string::npos) {
+      insertAt = source.find('\n', version);
+      insertAt = insertAt == std::string::npos ? source.size() : insertAt + 1;
+      versionLine = static_cast<std::size_t>(
+          std::count(source.begin(), source.begin() + insertAt, '\n'));
+    }
+    block += std::format("#line {} 0\n", versionLine + 1);
+    source.insert(insertAt, block);
+  }
+
+public:
+  explicit ShaderPreprocessor(ShaderIncludeResolver resolver = {}) noexcept
+      : _resolver(std::move(resolver)) {}
+
+  /* Resolves includes relative to a directory on disk. */
+  static ShaderPreprocessor fromDirectory(std::string directory) noexcept {
+    return ShaderPreprocessor(
+        [directory = std::move(directory)](std::string_view path) {
+          return readTextFile(std::format("{}/{}", directory, path));
+        });
+  }
+
+  Result<PreprocessedShader>
+  process(std::string_view name, std::string_view source,
+          std::span<const std::string> defines = {}) const noexcept {
+    PreprocessedShader out{.source = {}, .hash = 0, .dependencies = {}};
+    out.source.reserve(source.size());
+    std::vector<std::string> stack{std::string(name)};
+    CHECK_RESULT(expand(source, 0, out, stack));
+    injectDefines(out.source, defines);
+    out.hash = hashString(out.source);
+    return out;
+  }
+
+  /* Adds defines to an already expanded source, so permutations of one
+   * shader resolve its includes only once. */
+  static PreprocessedShader
+  withDefines(const PreprocessedShader &expanded,
+              std::span<const std::string> defines) noexcept {
+    auto out = expanded;
+    injectDefines(out.source, defines);
+    out.hash = hashString(out.source);
+    return out;
+  }
+};
+
+} // namespace na::gl
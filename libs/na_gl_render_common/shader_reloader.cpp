@@ -0,0 +1,394 @@
+module;
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <filesystem>
+#include <format>
+#include <glad/glad.h>
+#include <memory>
+#include <mutex>
+#include <na_error/macros.hpp>
+#include <optional>
+#include <poll.h>
+#include <span>
+#include <stop_token>
+#include <string>
+#include <string_view>
+#include <sys/inotify.h>
+#include <thread>
+#include <unistd.h>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+export module na_gl_render_common:shader_reloader;
+
+import na_error;
+import na_gl;
+import :file;
+import :shader;
+import :shader_preprocessor;
+
+namespace na::gl {
+
+std::string normalizePath(const std::string &path) noexcept {
+  std::error_code error;
+  auto absolute = std::filesystem::absolute(path, error);
+  return (error ? std::filesystem::path(path) : absolute)
+      .lexically_normal()
+      .string();
+}
+
+/* Watches shader files with inotify on a background thread. Directories are
+ * watched rather than files so editors that save by renaming a temporary
+ * file are picked up too. Changed files are read on the watcher thread. */
+export class ShaderFileWatcher {
+  int _inotifyFd;
+  std::mutex _mutex;
+  std::unordered_map<int, std::string> _directories;
+  std::unordered_set<std::string> _files;
+  std::unordered_map<std::string, std::string> _changes;
+  std::jthread _thread;
+
+  explicit ShaderFileWatcher(int inotifyFd) noexcept : _inotifyFd(inotifyFd) {}
+
+  void handleEvents() noexcept {
+    alignas(inotify_event) char buffer[4096];
+    while (true) {
+      auto length = read(_inotifyFd, buffer, sizeof(buffer));
+      if (length <= 0) {
+        return;
+      }
+      for (char *ptr = buffer; ptr < buffer + length;) {
+        auto *event = reinterpret_cast<inotify_event *>(ptr);
+        ptr += sizeof(inotify_event) + event->len;
+        if (event->len == 0) {
+          continue;
+        }
+        std::string path;
+        {
+          std::lock_guard lock(_mutex);
+          auto directory = _directories.find(event->wd);
+          if (directory == _directories.end()) {
+            continue;
+          }
+          path = directory->second + "/" + event->name;
+          if (!_files.contains(path)) {
+            continue;
+          }
+        }
+        auto source = readTextFile(path);
+        if (source.failed()) {
+          continue;
+        }
+        std::lock_guard lock(_mutex);
+        _changes[path] = std::move(source.value());
+      }
+    }
+  }
+
+  void run(std::stop_token stopToken) noexcept {
+    pollfd fd{.fd = _inotifyFd, .events = POLLIN, .revents = 0};
+    while (!stopToken.stop_requested()) {
+      if (poll(&fd, 1, 100) > 0 && (fd.revents & POLLIN)) {
+        handleEvents();
+      }
+    }
+  }
+
+public:
+  ShaderFileWatcher(const ShaderFileWatcher &) = delete;
+  ShaderFileWatcher &operator=(const ShaderFileWatcher &) = delete;
+
+  ~ShaderFileWatcher() noexcept {
+    _thread.request_stop();
+    if (_thread.joinable()) {
+      _thread.join();
+    }
+    close(_inotifyFd);
+  }
+
+  static UniqueResult<ShaderFileWatcher> create() noexcept {
+    int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0) {
+      return SimpleError("inotify_init1 failed, errno={}", errno);
+    }
+    auto watcher =
+        std::unique_ptr<ShaderFileWatcher>(new ShaderFileWatcher(fd));
+    watcher->_thread = std::jthread(
+        [watcher = watcher.get()](std::stop_token stopToken) {
+          watcher->run(stopToken);
+        });
+    return watcher;
+  }
+
+  VoidResult watch(const std::string &path) noexcept {
+    auto file = normalizePath(path);
+    auto directory = std::filesystem::path(file).parent_path().string();
+    std::lock_guard lock(_mutex);
+    if (_files.contains(file)) {
+      return {};
+    }
+    int wd = inotify_add_watch(_inotifyFd, directory.c_str(),
+                               IN_CLOSE_WRITE | IN_MOVED_TO);
+    if (wd < 0) {
+      return SimpleError("inotify_add_watch({}) failed, errno={}", directory,
+                         errno);
+    }
+    _directories[wd] = directory;
+    _files.insert(file);
+    return {};
+  }
+
+  /* Returns the latest contents of every file changed since the last call. */
+  std::unordered_map<std::string, std::string> takeChanges() noexcept {
+    std::lock_guard lock(_mutex);
+    return std::exchange(_changes, {});
+  }
+};
+
+export struct ShaderFile {
+  GLenum type;
+  std::string path;
+};
+
+export using ReloadableProgramId = std::size_t;
+
+/* Recompiles shader stages whose files, or files they #include, changed and
+ * relinks only the programs using them. Includes resolve relative to the
+ * stage's directory, which for built-in shaders is their pack's BASE_DIR.
+ * Compiles and links are submitted without blocking (see ShaderBatch) and
+ * programs are swapped inside update(), so callers that call it once per
+ * frame see the new program at a frame boundary. A stage or
+ * program that fails keeps the previous program in use. */
+export class ShaderHotReloader {
+  struct Stage {
+    GLenum type;
+    std::string path;
+    /* Normalized paths of the files the stage includes. */
+    std::vector<std::string> dependencies;
+    std::unique_ptr<ShaderStage> current;
+    std::unique_ptr<ShaderStage> pending;
+  };
+
+  struct Program {
+    std::string name;
+    ProgramOptions options;
+    std::vector<std::size_t> stages;
+    std::unique_ptr<ShaderProgram> current;
+    std::unique_ptr<ShaderProgram> pending;
+    bool relink = false;
+  };
+
+  std::unique_ptr<ShaderFileWatcher> _watcher;
+  std::vector<Stage> _stages;
+  std::vector<Program> _programs;
+
+  ShaderHotReloader(std::unique_ptr<ShaderFileWatcher> watcher) noexcept
+      : _watcher(std::move(watcher)) {}
+
+  /* Expands the stage's includes and watches every included file, so an
+   * edit to a shared header rebuilds the stages using it. */
+  Result<std::string> preprocess(Stage &stage,
+                                 std::string_view source) noexcept {
+    auto directory = std::filesystem::path(stage.path).parent_path().string();
+    auto preprocessor = ShaderPreprocessor::fromDirectory(directory);
+    UNIQUE_RESULT(expanded, preprocessor.process(stage.path, source));
+    stage.dependencies.clear();
+    for (const auto &dependency : expanded.dependencies) {
+      auto path = normalizePath(std::format("{}/{}", directory, dependency));
+      CHECK_RESULT(_watcher->watch(path));
+      stage.dependencies.push_back(std::move(path));
+    }
+    return std::move(expanded.source);
+  }
+
+  VoidResult compile(Stage &stage, std::string_view source) noexcept {
+    UNIQUE_RESULT(expanded, preprocess(stage, source));
+    UNIQUE_RESULT(shader, ShaderStage::createDeferred(stage.type, stage.path,
+                                                      expanded));
+    stage.pending = std::make_unique<ShaderStage>(std::move(shader));
+    return {};
+  }
+
+  /* New stages are scanned for includes right away, as programs handed to
+   * add() are usually built from the pack rather than these files. */
+  Result<std::size_t> stageIndex(const ShaderFile &file) noexcept {
+    auto path = normalizePath(file.path);
+    for (std::size_t i = 0; i < _stages.size(); ++i) {
+      if (_stages[i].path == path && _stages[i].type == file.type) {
+        return i;
+      }
+    }
+    Stage stage{.type = file.type,
+                .path = path,
+                .dependencies = {},
+                .current = nullptr,
+                .pending = nullptr};
+    AUTO_RESULT(source, readTextFile(path));
+    CHECK_RESULT(preprocess(stage, source));
+    _stages.push_back(std::move(stage));
+    return _stages.size() - 1;
+  }
+
+  /* Unchanged stages of a program being relinked are compiled on demand,
+   * since programs restored at startup carry no shader objects. */
+  VoidResult ensureStage(Stage &stage) noexcept {
+    if (stage.current || stage.pending) {
+      return {};
+    }
+    AUTO_RESULT(source, readTextFile(stage.path));
+    return compile(stage, source);
+  }
+
+  VoidResult startRelink(Program &program) noexcept {
+    std::vector<const ShaderStage *> stages;
+    for (auto index : program.stages) {
+      stages.push_back(_stages[index].current.get());
+    }
+    UNIQUE_RESULT(linked,
+                  ShaderProgram::createDeferred(stages.begin(), stages.end(),
+                                                program.name, program.options));
+    program.pending = std::make_unique<ShaderProgram>(std::move(linked));
+    return {};
+  }
+
+public:
+  ShaderHotReloader(const ShaderHotReloader &) = delete;
+  ShaderHotReloader &operator=(const ShaderHotReloader &) = delete;
+
+  static UniqueResult<ShaderHotReloader> create() noexcept {
+    UNIQUE_RESULT(watcher, ShaderFileWatcher::create());
+    return std::unique_ptr<ShaderHotReloader>(
+        new ShaderHotReloader(std::move(watcher)));
+  }
+
+  /* Takes ownership of a program built from the given files with the given
+   * options, which relinks reuse, and starts watching the files and their
+   * includes. */
+  Result<ReloadableProgramId> add(ShaderProgram program,
+                                  std::span<const ShaderFile> files,
+                                  ProgramOptions options = {}) noexcept {
+    Program entry{.name = std::string(program.name()),
+                  .options = options,
+                  .stages = {},
+                  .current = std::make_unique<ShaderProgram>(std::move(program)),
+                  .pending = nullptr};
+    for (const auto &file : files) {
+      CHECK_RESULT(_watcher->watch(file.path));
+      AUTO_RESULT(index, stageIndex(file));
+      entry.stages.push_back(index);
+    }
+    _programs.push_back(std::move(entry));
+    return _programs.size() - 1;
+  }
+
+  const ShaderProgram &program(ReloadableProgramId id) const noexcept {
+    return *_programs[id].current;
+  }
+
+  /* Advances pending recompiles; call once per frame. Returns the errors of
+   * stages or programs that failed to rebuild. */
+  VoidResult update() noexcept {
+    std::vector<std::string> errors;
+    auto report = [&errors](const SimpleError &error) {
+      errors.emplace_back(error.message());
+    };
+
+    auto changes = _watcher->takeChanges();
+    for (std::size_t i = 0; i < _stages.size(); ++i) {
+      auto &stage = _stages[i];
+      auto changed = changes.find(stage.path);
+      auto includeChanged = std::ranges::any_of(
+          stage.dependencies,
+          [&changes](const auto &path) { return changes.contains(path); });
+      if (changed == changes.end() && !includeChanged) {
+        continue;
+      }
+      // Includes are read by the preprocessor; only the stage's own file
+      // may need reading when just an include changed.
+      std::string source;
+      if (changed != changes.end()) {
+        source = changed->second;
+      } else if (auto read = readTextFile(stage.path); read.ok()) {
+        source = std::move(read.value());
+      } else {
+        report(read.error());
+        continue;
+      }
+      if (auto result = compile(stage, source); result.failed()) {
+        report(result.error());
+        continue;
+      }
+      for (auto &program : _programs) {
+        if (std::ranges::find(program.stages, i) != program.stages.end()) {
+          program.relink = true;
+        }
+      }
+    }
+
+    for (auto &program : _programs) {
+      if (!program.relink) {
+        continue;
+      }
+      for (auto index : program.stages) {
+        if (auto result = ensureStage(_stages[index]); result.failed()) {
+          report(result.error());
+          program.relink = false;
+        }
+      }
+    }
+
+    for (std::size_t i = 0; i < _stages.size(); ++i) {
+      auto &stage = _stages[i];
+      if (!stage.pending || !stage.pending->compileCompleted()) {
+        continue;
+      }
+      if (auto status = stage.pending->compileStatus(); status.failed()) {
+        report(status.error());
+        stage.pending.reset();
+        for (auto &program : _programs) {
+          if (std::ranges::find(program.stages, i) != program.stages.end()) {
+            program.relink = false;
+          }
+        }
+        continue;
+      }
+      stage.current = std::move(stage.pending);
+    }
+
+    for (auto &program : _programs) {
+      auto stagesReady = std::ranges::all_of(program.stages, [this](auto i) {
+        return _stages[i].current && !_stages[i].pending;
+      });
+      if (program.relink && stagesReady) {
+        program.relink = false;
+        if (auto result = startRelink(program); result.failed()) {
+          report(result.error());
+        }
+      }
+      if (!program.pending || !program.pending->linkCompleted()) {
+        continue;
+      }
+      if (auto status = program.pending->linkStatus(); status.failed()) {
+        report(status.error());
+        program.pending.reset();
+        continue;
+      }
+      program.current = std::move(program.pending);
+    }
+
+    if (errors.empty()) {
+      return {};
+    }
+    std::string message = "shader reload failed";
+    for (const auto &error : errors) {
+      message += "\n  " + error;
+    }
+    return SimpleError(message);
+  }
+};
+
+} // namespace na::gl
@@ -0,0 +1,191 @@
+module;
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <format>
+#include <glad/glad.h>
+#include <memory>
+#include <na_error/macros.hpp>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+export module na_gl_render_common:shader_variants;
+
+import na_error;
+import :program_cache;
+import :shader;
+import :shader_batch;
+import :shader_preprocessor;
+
+namespace na::gl {
+
+/* Bit i of a mask enables the i-th define of the variant cache. */
+export using ShaderVariantMask = std::uint64_t;
+
+export struct ShaderVariantStats {
+  /* Masks requested so far. */
+  std::size_t variants{};
+  /* Programs actually compiled or restored. */
+  std::size_t programs{};
+  /* Masks that resolved to an already known program. */
+  std::size_t deduplicated{};
+};
+
+/* Permutations of one program keyed by a define bitmask. Includes are
+ * resolved once when the cache is created; a variant is compiled the first
+ * time it is requested, or ahead of time through prewarm(). Variants whose
+ * preprocessed sources are identical share a single program. */
+export class ShaderVariantCache {
+  static constexpr std::size_t MAX_DEFINES = 64;
+
+  struct Variant {
+    std::optional<ShaderProgram> program;
+    std::optional<SimpleError> error;
+    ProgramFuture future;
+  };
+
+  std::string _name;
+  std::vector<std::string> _defines;
+  std::vector<GLenum> _types;
+  std::vector<PreprocessedShader> _expanded;
+  ShaderBatch &_batch;
+  std::unordered_map<ShaderVariantMask, std::uint64_t> _programKeys;
+  std::unordered_map<std::uint64_t, Variant> _programs;
+  ShaderVariantStats _stats{};
+
+  ShaderVariantCache(std::string name, std::vector<std::string> defines,
+                     ShaderBatch &batch) noexcept
+      : _name(std::move(name)), _defines(std::move(defines)), _batch(batch) {}
+
+  std::vector<std::string> definesFor(ShaderVariantMask mask) const noexcept {
+    std::vector<std::string> defines;
+    for (; mask != 0; mask &= mask - 1) {
+      auto bit = static_cast<std::size_t>(std::countr_zero(mask));
+      if (bit < _defines.size()) {
+        defines.push_back(_defines[bit]);
+      }
+    }
+    return defines;
+  }
+
+  /* Preprocesses the variant on first request and starts compiling its
+   * program unless one with the same sources already exists. */
+  Variant &variant(ShaderVariantMask mask) noexcept {
+    if (auto known = _programKeys.find(mask); known != _programKeys.end()) {
+      return _programs[known->second];
+    }
+    _stats.variants++;
+
+    auto defines = definesFor(mask);
+    std::vector<PreprocessedShader> stages;
+    std::vector<ShaderSource> sources;
+    stages.reserve(_expanded.size());
+    for (std::size_t i = 0; i < _expanded.size(); ++i) {
+      stages.push_back(ShaderPreprocessor::withDefines(_expanded[i], defines));
+      sources.push_back({.type = _types[i], .source = stages.back().source});
+    }
+    auto key = ProgramCache::programKey(sources);
+    _programKeys.emplace(mask, key);
+
+    auto [it, inserted] = _programs.try_emplace(key);
+    if (!inserted) {
+      _stats.deduplicated++;
+      return it->second;
+    }
+    _stats.programs++;
+    it->second.future =
+        _batch.add(std::format("{}#{:x}", _name, mask), sources);
+    return it->second;
+  }
+
+  static void harvest(Variant &variant) noexcept {
+    if (!variant.future.ready()) {
+      return;
+    }
+    auto result = variant.future.take();
+    if (result.failed()) {
+      variant.error = result.error();
+    } else {
+      variant.program.emplace(std::move(result.value()));
+    }
+  }
+
+public:
+  ShaderVariantCache(const ShaderVariantCache &) = delete;
+  ShaderVariantCache &operator=(const ShaderVariantCache &) = delete;
+
+  /* Resolves the includes of every stage; compiles go through the batch,
+   * which must outlive the cache. */
+  static UniqueResult<ShaderVariantCache>
+  create(std::string name, const ShaderPreprocessor &preprocessor,
+         std::span<const ShaderSource> stages,
+         std::vector<std::string> defines, ShaderBatch &batch) noexcept {
+    if (defines.size() > MAX_DEFINES) {
+      return SimpleError("{} has {} defines, at most {} are supported", name,
+                         defines.size(), MAX_DEFINES);
+    }
+    auto cache = std::unique_ptr<ShaderVariantCache>(
+        new ShaderVariantCache(std::move(name), std::move(defines), batch));
+    for (std::size_t i = 0; i < stages.size(); ++i) {
+      auto expanded = preprocessor.process(
+          std::format("{}_{}", cache->_name, i), stages[i].source);
+      if (expanded.failed()) {
+        return expanded.errorWithPrefix("shader {}", cache->_name);
+      }
+      cache->_types.push_back(stages[i].type);
+      cache->_expanded.push_back(std::move(expanded.value()));
+    }
+    return cache;
+  }
+
+  const ShaderVariantStats &stats() const noexcept { return _stats; }
+
+  /* Starts compiling the given variants without waiting for them. */
+  void prewarm(std::span<const ShaderVariantMask> masks) noexcept {
+    for (auto mask : masks) {
+      variant(mask);
+    }
+  }
+
+  /* Picks up variants that finished compiling; call once per frame. */
+  void poll() noexcept {
+    _batch.poll();
+    for (auto &[key, variant] : _programs) {
+      harvest(variant);
+    }
+  }
+
+  /* Returns the variant if it is ready, otherwise starts compiling it and
+   * returns nullptr so callers can skip or fall back for this frame. */
+  const ShaderProgram *tryGet(ShaderVariantMask mask) noexcept {
+    auto &entry = variant(mask);
+    harvest(entry);
+    return entry.program ? &*entry.program : nullptr;
+  }
+
+  /* Returns the variant, compiling it and waiting for the driver if it has
+   * not been built yet. */
+  Result<const ShaderProgram *> get(ShaderVariantMask mask) noexcept {
+    auto &entry = variant(mask);
+    while (!entry.program && !entry.error) {
+      if (!entry.future.ready()) {
+        _batch.poll();
+        std::this_thread::yield();
+      }
+      harvest(entry);
+    }
+    if (entry.error) {
+      return *entry.error;
+    }
+    return &*entry.program;
+  }
+};
+
+} // namespace na::gl
@@ -0,0 +1,135 @@
+module;
+
+#include <array>
+#include <cstddef>
+#include <glad/glad.h>
+#include <na_error/macros.hpp>
+#include <optional>
+
+export module na_gl_render_common:stream_buffer;
+
+import na_error;
+import na_gl;
+
+namespace na::gl {
+
+export struct StreamAllocation {
+  std::byte *data;
+  /* Offset into the buffer, for glBindBufferRange. */
+  GLintptr offset;
+  GLsizeiptr size;
+};
+
+/* A persistently mapped buffer split into one region per frame in flight.
+ * beginFrame() waits for the GPU to release the region written FRAMES frames
+ * ago, allocate() hands out pointers into it for CPU writes, and endFrame()
+ * fences it; the mapping is coherent, so nothing needs flushing. */
+export class StreamBuffer {
+public:
+  static constexpr std::size_t FRAMES = 3;
+
+private:
+  GLuint _id{};
+  std::byte *_mapping = nullptr;
+  std::size_t _frameSize = 0;
+  std::size_t _frame = 0;
+  std::size_t _cursor = 0;
+  std::array<GLsync, FRAMES> _fences{};
+
+  StreamBuffer(GLuint id, std::byte *mapping, std::size_t frameSize) noexcept
+      : _id(id), _mapping(mapping), _frameSize(frameSize) {}
+
+public:
+  StreamBuffer(const StreamBuffer &) = delete;
+  StreamBuffer &operator=(const StreamBuffer &) = delete;
+  StreamBuffer &operator=(StreamBuffer &&) noexcept = delete;
+
+  StreamBuffer(StreamBuffer &&other) noexcept
+      : _id(other._id), _mapping(other._mapping),
+        _frameSize(other._frameSize), _frame(other._frame),
+        _cursor(other._cursor), _fences(other._fences) {
+    other._id = 0;
+    other._mapping = nullptr;
+    other._fences = {};
+  }
+
+  ~StreamBuffer() noexcept {
+    for (auto fence : _fences) {
+      if (fence != nullptr) {
+        GL::instance().deleteSync(fence);
+      }
+    }
+    if (_id != 0) {
+      // Deleting the buffer unmaps it; the driver keeps the storage alive
+      // until draws still reading it have finished.
+      GL::instance().deleteBuffer(_id);
+    }
+  }
+
+  GLuint id() const noexcept { return _id; }
+
+  std::size_t frameSize() const noexcept { return _frameSize; }
+
+  /* Bytes allocated in the current frame, including alignment padding. */
+  std::size_t used() const noexcept { return _cursor; }
+
+  static Result<StreamBuffer> create(std::size_t frameSize) noexcept {
+    constexpr GLbitfield flags =
+        GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    auto size = static_cast<GLsizeiptr>(frameSize * FRAMES);
+    AUTO_RESULT(bufferId, GL::instance().createBuffer());
+    StreamBuffer buffer(bufferId, nullptr, frameSize);
+    CHECK_RESULT(
+        GL::instance().namedBufferStorage(bufferId, size, nullptr, flags));
+    AUTO_RESULT(mapping,
+                GL::instance().mapNamedBufferRange(bufferId, 0, size, flags));
+    buffer._mapping = static_cast<std::byte *>(mapping);
+    return buffer;
+  }
+
+  VoidResult beginFrame() noexcept {
+    _cursor = 0;
+    auto &fence = _fences[_frame];
+    if (fence == nullptr) {
+      return {};
+    }
+    constexpr GLuint64 TIMEOUT_NS = 1'000'000'000;
+    while (true) {
+      AUTO_RESULT(status, GL::instance().clientWaitSync(
+                              fence, GL_SYNC_FLUSH_COMMANDS_BIT, TIMEOUT_NS));
+      if (status != GL_TIMEOUT_EXPIRED) {
+        break;
+      }
+    }
+    CHECK_RESULT(GL::instance().deleteSync(fence));
+    fence = nullptr;
+    return {};
+  }
+
+  /* Returns nullopt when the frame's region is full. alignment must be a
+   * power of two. */
+  std::optional<StreamAllocation> allocate(std::size_t size,
+                                           std::size_t alignment) noexcept {
+    auto start = (_cursor + alignment - 1) & ~(alignment - 1);
+    if (start + size > _frameSize) {
+      return std::nullopt;
+    }
+    _cursor = start + size;
+    auto offset = _frame * _frameSize + start;
+    return StreamAllocation{
+        .data = _mapping + offset,
+        .offset = static_cast<GLintptr>(offset),
+        .size = static_cast<GLsizeiptr>(size),
+    };
+  }
+
+  /* Fences the frame's region after the draws reading it were submitted. */
+  VoidResult endFrame() noexcept {
+    AUTO_RESULT(fence, GL::instance().fenceSync());
+    _fences[_frame] = fence;
+    _frame = (_frame + 1) % FRAMES;
+    return {};
+  }
+};
+
+} // namespace na::gl
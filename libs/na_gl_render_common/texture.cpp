@@ -0,0 +1,178 @@
+module;
+
+#include <algorithm>
+#include <cstddef>
+#include <glad/glad.h>
+#include <na_error/macros.hpp>
+
+export module na_gl_render_common:texture;
+
+import na_error;
+import na_gl;
+
+namespace na::gl {
+
+/* Returns the storage size of one texel for uncompressed sized formats, or 0
+ * for formats the engine does not allocate render targets with. */
+export std::size_t textureFormatBytesPerPixel(GLenum format) noexcept {
+  switch (format) {
+  case GL_R8:
+  case GL_R8UI:
+    return 1;
+  case GL_RG8:
+  case GL_R16F:
+  case GL_R16UI:
+  case GL_DEPTH_COMPONENT16:
+    return 2;
+  case GL_RGBA8:
+  case GL_SRGB8_ALPHA8:
+  case GL_RG16F:
+  case GL_R11F_G11F_B10F:
+  case GL_RGB10_A2:
+  case GL_R32F:
+  case GL_R32UI:
+  case GL_DEPTH_COMPONENT24:
+  case GL_DEPTH24_STENCIL8:
+  case GL_DEPTH_COMPONENT32F:
+    return 4;
+  case GL_RGBA16F:
+  case GL_DEPTH32F_STENCIL8:
+    return 8;
+  case GL_RGBA32F:
+    return 16;
+  default:
+    return 0;
+  }
+}
+
+export bool isDepthFormat(GLenum format) noexcept {
+  switch (format) {
+  case GL_DEPTH_COMPONENT16:
+  case GL_DEPTH_COMPONENT24:
+  case GL_DEPTH_COMPONENT32F:
+  case GL_DEPTH24_STENCIL8:
+  case GL_DEPTH32F_STENCIL8:
+    return true;
+  default:
+    return false;
+  }
+}
+
+/* Integer formats are read with texelFetch or usampler and cannot be
+ * linearly filtered. */
+export bool isIntegerFormat(GLenum format) noexcept {
+  switch (format) {
+  case GL_R8UI:
+  case GL_R16UI:
+  case GL_R32UI:
+    return true;
+  default:
+    return false;
+  }
+}
+
+export bool isDepthStencilFormat(GLenum format) noexcept {
+  return format == GL_DEPTH24_STENCIL8 || format == GL_DEPTH32F_STENCIL8;
+}
+
+export class Texture {
+  GLuint _id{};
+  GLenum _format{};
+  GLsizei _width{};
+  GLsizei _height{};
+  GLsizei _levels{};
+  GLsizei _layers{};
+  Texture(GLuint id, GLenum format, GLsizei width, GLsizei height,
+          GLsizei levels, GLsizei layers) noexcept
+      : _id(id), _format(format), _width(width), _height(height),
+        _levels(levels), _layers(layers) {}
+
+  /* Linear filtering (nearest for depth and integer formats) and clamped
+   * edges. */
+  static VoidResult setDefaultSampling(GLuint textureId,
+                                       GLenum format) noexcept {
+    GLint filter = isDepthFormat(format) || isIntegerFormat(format)
+                       ? GL_NEAREST
+                       : GL_LINEAR;
+    CHECK_RESULT(GL::instance().textureParameteri(
+        textureId, GL_TEXTURE_MIN_FILTER, filter));
+    CHECK_RESULT(GL::instance().textureParameteri(
+        textureId, GL_TEXTURE_MAG_FILTER, filter));
+    CHECK_RESULT(GL::instance().textureParameteri(textureId, GL_TEXTURE_WRAP_S,
+                                                  GL_CLAMP_TO_EDGE));
+    return GL::instance().textureParameteri(textureId, GL_TEXTURE_WRAP_T,
+                                            GL_CLAMP_TO_EDGE);
+  }
+
+public:
+  Texture(const Texture &) = delete;
+  Texture &operator=(const Texture &) = delete;
+  Texture &operator=(Texture &&) noexcept = delete;
+
+  Texture(Texture &&other) noexcept
+      : _id(other._id), _format(other._format), _width(other._width),
+        _height(other._height), _levels(other._levels),
+        _layers(other._layers) {
+    other._id = 0;
+  }
+
+  ~Texture() noexcept {
+    if (_id != 0) {
+      GL::instance().deleteTexture(_id);
+    }
+  }
+
+  GLuint id() const noexcept { return _id; }
+
+  GLenum format() const noexcept { return _format; }
+
+  GLsizei width() const noexcept { return _width; }
+
+  GLsizei height() const noexcept { return _height; }
+
+  GLsizei levels() const noexcept { return _levels; }
+
+  /* 1 for 2D textures, the array size for 2D array textures. */
+  GLsizei layers() const noexcept { return _layers; }
+
+  std::size_t byteSize() const noexcept {
+    std::size_t bytes = 0;
+    for (GLsizei level = 0; level < _levels; ++level) {
+      auto width = static_cast<std::size_t>(std::max(_width >> level, 1));
+      auto height = static_cast<std::size_t>(std::max(_height >> level, 1));
+      bytes += width * height * textureFormatBytesPerPixel(_format);
+    }
+    return bytes * static_cast<std::size_t>(_layers);
+  }
+
+  static Result<Texture> create2D(GLenum format, GLsizei width, GLsizei height,
+                                  GLsizei levels = 1) noexcept {
+    if (width <= 0 || height <= 0 || levels <= 0) {
+      return SimpleError("invalid texture size {}x{} with {} levels", width,
+                         height, levels);
+    }
+    AUTO_RESULT(textureId, GL::instance().createTexture(GL_TEXTURE_2D));
+    Texture texture(textureId, format, width, height, levels, 1);
+    CHECK_RESULT(GL::instance().textureStorage2D(textureId, levels, format,
+                                                 width, height));
+    CHECK_RESULT(setDefaultSampling(textureId, format));
+    return texture;
+  }
+
+  static Result<Texture> create2DArray(GLenum format, GLsizei width,
+                                       GLsizei height, GLsizei layers,
+                                       GLsizei levels = 1) noexcept {
+    if (width <= 0 || height <= 0 || layers <= 0 || levels <= 0) {
+      return SimpleError("invalid texture array size {}x{}x{} with {} levels",
+                         width, height, layers, levels);
+    }
+    AUTO_RESULT(textureId, GL::instance().createTexture(GL_TEXTURE_2D_ARRAY));
+    Texture texture(textureId, format, width, height, levels, layers);
+    CHECK_RESULT(GL::instance().textureStorage3D(textureId, levels, format,
+                                                 width, height, layers));
+    CHECK_RESULT(setDefaultSampling(textureId, format));
+    return texture;
+  }
+};
+
+} // namespace na::gl
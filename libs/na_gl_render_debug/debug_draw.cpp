@@ -0,0 +1,319 @@
+module;
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+#include <memory>
+#include <na_error/macros.hpp>
+#include <optional>
+#include <vector>
+
+export module na_gl_render_debug:debug_draw;
+
+import na_error;
+import na_gl;
+import na_gl_render_common;
+#ifndef NDEBUG
+import na_gl_render_debug_shaders;
+#endif
+
+namespace na::gl {
+
+/* False in release builds, where DebugDraw compiles to empty inline calls
+ * and owns no GL objects. */
+#ifdef NDEBUG
+export constexpr bool DEBUG_DRAW_ENABLED = false;
+#else
+export constexpr bool DEBUG_DRAW_ENABLED = true;
+#endif
+
+export enum class DebugFill { Outline, Solid };
+
+export struct DebugDrawConfig {
+  /* Vertices per frame the stream starts with; it doubles after a frame that
+   * ran out of space. */
+  std::size_t initialVertices = 65536;
+};
+
+#ifndef NDEBUG
+
+/* Matches "DebugVertex" in debug.vert. color is RGBA8. */
+using DebugVertex =
+    GpuStruct<"DebugVertex", GpuLayoutRule::Std430,
+              GpuField<"position", glm::vec3>,
+              GpuField<"color", std::uint32_t>>;
+
+static_assert(DebugVertex::SIZE == 16);
+
+/* Immediate-mode lines, rectangles, circles and arrows for visualising game
+ * state. Primitives accumulate on the CPU during the frame, sorted only by
+ * topology and depth testing; draw() copies them into a persistently mapped
+ * stream and issues at most one glDrawArrays per list, however many
+ * primitives were added. Vertices are pulled from an SSBO by gl_VertexID.
+ * Rectangles, circles and arrow heads lie in the XY plane at their z. */
+export class DebugDraw {
+  /* Lines or triangles, each with and without the depth test. */
+  enum List : std::size_t {
+    LINES,
+    TRIANGLES,
+    DEPTH_LINES,
+    DEPTH_TRIANGLES,
+    LIST_COUNT,
+  };
+
+  static constexpr std::array<GLenum, LIST_COUNT> MODES = {
+      GL_LINES, GL_TRIANGLES, GL_LINES, GL_TRIANGLES};
+
+  std::optional<StreamBuffer> _stream;
+  std::optional<ShaderProgram> _program;
+  GLuint _vertexArray{};
+  std::size_t _alignment;
+  std::size_t _capacity;
+  bool _grow = false;
+  bool _depthTest = false;
+  CameraShared _shared{};
+  const CameraBuffer *_cameras = nullptr;
+  CameraId _camera{};
+  std::array<std::vector<DebugVertex>, LIST_COUNT> _lists;
+
+  DebugDraw(DebugDrawConfig config, std::size_t alignment) noexcept
+      : _alignment(alignment), _capacity(config.initialVertices) {}
+
+  /* Room for every list plus the Shared block, each starting aligned. */
+  std::size_t frameSize(std::size_t capacity) const noexcept {
+    auto size = capacity * DebugVertex::SIZE + CameraShared::SIZE +
+                (LIST_COUNT + 1) * _alignment;
+    return (size + _alignment - 1) & ~(_alignment - 1);
+  }
+
+  std::vector<DebugVertex> &list(bool triangles) noexcept {
+    auto base = _depthTest ? DEPTH_LINES : LINES;
+    return _lists[base + (triangles ? 1 : 0)];
+  }
+
+  static void push(std::vector<DebugVertex> &vertices, glm::vec3 position,
+                   std::uint32_t color) noexcept {
+    vertices.emplace_back().set<"position">(position).set<"color">(color);
+  }
+
+  static Result<ShaderProgram> createProgram() noexcept {
+    const auto &pack = na_gl_render_debug_shaders::PACK;
+    UNIQUE_RESULT(vertex,
+                  ShaderStage::create(GL_VERTEX_SHADER, "debug",
+                                      pack.find("debug.vert")->source));
+    UNIQUE_RESULT(fragment,
+                  ShaderStage::create(GL_FRAGMENT_SHADER, "debug",
+                                      pack.find("debug.frag")->source));
+    return ShaderProgram::create({&vertex, &fragment}, "debug");
+  }
+
+  void clear() noexcept {
+    for (auto &vertices : _lists) {
+      vertices.clear();
+    }
+  }
+
+public:
+  DebugDraw(const DebugDraw &) = delete;
+  DebugDraw &operator=(const DebugDraw &) = delete;
+
+  ~DebugDraw() noexcept {
+    if (_vertexArray != 0) {
+      GL::instance().deleteVertexArray(_vertexArray);
+    }
+  }
+
+  static UniqueResult<DebugDraw> create(DebugDrawConfig config = {}) noexcept {
+    AUTO_RESULT(storageAlignment, GL::instance().getInteger(
+                                      GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT));
+    AUTO_RESULT(uniformAlignment, GL::instance().getInteger(
+                                      GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT));
+    auto alignment = std::max<std::size_t>(
+        {static_cast<std::size_t>(storageAlignment),
+         static_cast<std::size_t>(uniformAlignment), DebugVertex::ALIGNMENT});
+    auto debug = std::unique_ptr<DebugDraw>(new DebugDraw(config, alignment));
+    UNIQUE_RESULT(stream,
+                  StreamBuffer::create(debug->frameSize(debug->_capacity)));
+    debug->_stream.emplace(std::move(stream));
+    UNIQUE_RESULT(program, createProgram());
+    debug->_program.emplace(std::move(program));
+    AUTO_RESULT(vertexArray, GL::instance().createVertexArray());
+    debug->_vertexArray = vertexArray;
+    return debug;
+  }
+
+  void setCamera(const glm::mat4 &view, const glm::mat4 &projection) noexcept {
+    _shared.set<"view">(view).set<"projection">(projection);
+    _cameras = nullptr;
+  }
+
+  /* Draws through a camera of a shared CameraBuffer, bound by draw(). */
+  void setCamera(const CameraBuffer &cameras, CameraId camera) noexcept {
+    _cameras = &cameras;
+    _camera = camera;
+  }
+
+  /* Primitives added from now on are hidden behind nearer geometry in the
+   * depth buffer; they never write depth themselves. */
+  void setDepthTest(bool enabled) noexcept { _depthTest = enabled; }
+
+  void line(glm::vec3 from, glm::vec3 to, glm::vec4 color) noexcept {
+    auto &vertices = list(false);
+    auto packed = glm::packUnorm4x8(color);
+    push(vertices, from, packed);
+    push(vertices, to, packed);
+  }
+
+  void rect(glm::vec3 min, glm::vec2 size, glm::vec4 color,
+            DebugFill fill = DebugFill::Outline) noexcept {
+    auto packed = glm::packUnorm4x8(color);
+    std::array<glm::vec3, 4> corners = {
+        min, min + glm::vec3(size.x, 0.0f, 0.0f),
+        min + glm::vec3(size, 0.0f), min + glm::vec3(0.0f, size.y, 0.0f)};
+    if (fill == DebugFill::Solid) {
+      auto &vertices = list(true);
+      for (auto i : {0, 1, 2, 0, 2, 3}) {
+        push(vertices, corners[static_cast<std::size_t>(i)], packed);
+      }
+      return;
+    }
+    auto &vertices = list(false);
+    for (std::size_t i = 0; i < corners.size(); ++i) {
+      push(vertices, corners[i], packed);
+      push(vertices, corners[(i + 1) % corners.size()], packed);
+    }
+  }
+
+  void circle(glm::vec3 center, float radius, glm::vec4 color,
+              DebugFill fill = DebugFill::Outline,
+              int segments = 32) noexcept {
+    constexpr float TAU = 6.283185307179586f;
+    auto packed = glm::packUnorm4x8(color);
+    auto &vertices = list(fill == DebugFill::Solid);
+    segments = std::max(segments, 3);
+    auto point = [&](int i) noexcept {
+      auto angle = TAU * static_cast<float>(i) / static_cast<float>(segments);
+      return center +
+             glm::vec3(std::cos(angle), std::sin(angle), 0.0f) * radius;
+    };
+    auto previous = point(0);
+    for (int i = 1; i <= segments; ++i) {
+      auto next = point(i);
+      if (fill == DebugFill::Solid) {
+        push(vertices, center, packed);
+      }
+      push(vertices, previous, packed);
+      push(vertices, next, packed);
+      previous = next;
+    }
+  }
+
+  /* A line with a head of headSize world units at to. */
+  void arrow(glm::vec3 from, glm::vec3 to, glm::vec4 color,
+             float headSize = 0.25f) noexcept {
+    line(from, to, color);
+    auto delta = glm::vec2(to - from);
+    auto length = glm::length(delta);
+    if (length == 0.0f) {
+      return;
+    }
+    auto direction = glm::vec3(delta / length, 0.0f) * headSize;
+    auto side = glm::vec3(-direction.y, direction.x, 0.0f) * 0.5f;
+    line(to, to - direction + side, color);
+    line(to, to - direction - side, color);
+  }
+
+  /* Draws everything added since the last draw() and clears it. Blends over
+   * the frame and leaves blending and the depth test disabled. */
+  VoidResult draw() noexcept {
+    if (_grow) {
+      _grow = false;
+      _capacity *= 2;
+      _stream.reset();
+      UNIQUE_RESULT(stream, StreamBuffer::create(frameSize(_capacity)));
+      _stream.emplace(std::move(stream));
+    }
+    std::size_t total = 0;
+    for (const auto &vertices : _lists) {
+      total += vertices.size();
+    }
+    if (total == 0) {
+      return {};
+    }
+    if (total > _capacity) {
+      // Drawn from the next frame on; this frame's primitives are dropped.
+      _grow = true;
+      clear();
+      return {};
+    }
+    CHECK_RESULT(_stream->beginFrame());
+    if (_cameras != nullptr) {
+      CHECK_RESULT(_cameras->bind(_camera));
+    } else {
+      auto shared = *_stream->allocate(CameraShared::SIZE, _alignment);
+      std::memcpy(shared.data, &_shared, CameraShared::SIZE);
+      CHECK_RESULT(GL::instance().bindBufferRange(
+          GL_UNIFORM_BUFFER, 0, _stream->id(), shared.offset, shared.size));
+    }
+    CHECK_RESULT(GL::instance().useProgram(_program->id()));
+    CHECK_RESULT(GL::instance().bindVertexArray(_vertexArray));
+    CHECK_RESULT(GL::instance().enable(GL_BLEND));
+    CHECK_RESULT(
+        GL::instance().blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA));
+    CHECK_RESULT(GL::instance().depthMask(GL_FALSE));
+    for (std::size_t i = 0; i < LIST_COUNT; ++i) {
+      const auto &vertices = _lists[i];
+      if (vertices.empty()) {
+        continue;
+      }
+      auto bytes = vertices.size() * DebugVertex::SIZE;
+      auto allocation = *_stream->allocate(bytes, _alignment);
+      std::memcpy(allocation.data, vertices.data(), bytes);
+      CHECK_RESULT(GL::instance().bindBufferRange(
+          GL_SHADER_STORAGE_BUFFER, 0, _stream->id(), allocation.offset,
+          allocation.size));
+      if (i == DEPTH_LINES || i == DEPTH_TRIANGLES) {
+        CHECK_RESULT(GL::instance().enable(GL_DEPTH_TEST));
+      } else {
+        CHECK_RESULT(GL::instance().disable(GL_DEPTH_TEST));
+      }
+      CHECK_RESULT(GL::instance().drawArrays(
+          MODES[i], 0, static_cast<GLsizei>(vertices.size())));
+    }
+    CHECK_RESULT(GL::instance().depthMask(GL_TRUE));
+    CHECK_RESULT(GL::instance().disable(GL_DEPTH_TEST));
+    CHECK_RESULT(GL::instance().disable(GL_BLEND));
+    clear();
+    return _stream->endFrame();
+  }
+};
+
+#else
+
+export class DebugDraw {
+public:
+  static UniqueResult<DebugDraw> create(DebugDrawConfig = {}) noexcept {
+    return std::make_unique<DebugDraw>();
+  }
+
+  void setCamera(const glm::mat4 &, const glm::mat4 &) noexcept {}
+  void setCamera(const CameraBuffer &, CameraId) noexcept {}
+  void setDepthTest(bool) noexcept {}
+  void line(glm::vec3, glm::vec3, glm::vec4) noexcept {}
+  void rect(glm::vec3, glm::vec2, glm::vec4,
+            DebugFill = DebugFill::Outline) noexcept {}
+  void circle(glm::vec3, float, glm::vec4, DebugFill = DebugFill::Outline,
+              int = 32) noexcept {}
+  void arrow(glm::vec3, glm::vec3, glm::vec4, float = 0.25f) noexcept {}
+  VoidResult draw() noexcept { return {}; }
+};
+
+#endif
+
+} // namespace na::gl
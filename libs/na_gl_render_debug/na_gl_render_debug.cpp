@@ -0,0 +1,3 @@
+export module na_gl_render_debug;
+
+export import :debug_draw;
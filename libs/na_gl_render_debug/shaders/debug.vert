@@ -0,0 +1,28 @@
+#version 450 core
+
+struct DebugVertex {
+  vec3 position;
+  uint color;
+};
+
+layout (binding = 0) uniform Shared {
+  mat4 view;
+  mat4 projection;
+  float time;
+};
+
+layout (binding = 0, std430) readonly buffer Vertices {
+  DebugVertex vertices[];
+};
+
+layout (location = 0) out vec4 outColor;
+
+out gl_PerVertex {
+  vec4 gl_Position;
+};
+
+void main() {
+  DebugVertex vertex = vertices[gl_VertexID];
+  outColor = unpackUnorm4x8(vertex.color);
+  gl_Position = projection * view * vec4(vertex.position, 1.0);
+}
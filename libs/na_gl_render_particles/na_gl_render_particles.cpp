@@ -0,0 +1,3 @@
+export module na_gl_render_particles;
+
+export import :particle_system;
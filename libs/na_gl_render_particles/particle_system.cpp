@@ -0,0 +1,304 @@
+module;
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <format>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <memory>
+#include <na_error/macros.hpp>
+#include <string>
+#include <string_view>
+#include <vector>
+
+export module na_gl_render_particles:particle_system;
+
+import na_error;
+import na_gl;
+import na_gl_render_common;
+import na_gl_render_particles_shaders;
+
+namespace na::gl {
+
+/* Matches "Particle" in particle_common.glsl. color is RGBA8; life counts
+ * down from maxLife in seconds. */
+export using Particle =
+    GpuStruct<"Particle", GpuLayoutRule::Std430,
+              GpuField<"position", glm::vec2>, GpuField<"velocity", glm::vec2>,
+              GpuField<"color", std::uint32_t>, GpuField<"life", float>,
+              GpuField<"maxLife", float>, GpuField<"size", float>>;
+
+static_assert(Particle::SIZE == 32);
+
+/* Matches "ParticleBurst": end is the exclusive end of the burst's emit
+ * indices, so particle_emit.comp finds its burst by cumulative count. */
+using ParticleBurst =
+    GpuStruct<"ParticleBurst", GpuLayoutRule::Std140,
+              GpuField<"origin", glm::vec2>, GpuField<"speed", float>,
+              GpuField<"life", float>, GpuField<"color", glm::vec4>,
+              GpuField<"size", float>, GpuField<"end", std::uint32_t>>;
+
+constexpr std::size_t MAX_BURSTS = 16;
+
+/* Matches the "ParticleFrame" block; UBO binding 0 in every pass. */
+using ParticleFrame =
+    GpuStruct<"ParticleFrame", GpuLayoutRule::Std140,
+              GpuField<"view", glm::mat4>, GpuField<"projection", glm::mat4>,
+              GpuField<"gravity", glm::vec2>, GpuField<"deltaTime", float>,
+              GpuField<"seed", std::uint32_t>,
+              GpuField<"burstCount", std::uint32_t>,
+              GpuField<"bursts", std::array<ParticleBurst, MAX_BURSTS>>>;
+
+/* The "ParticleState" block: the simulate pass's dispatch command, the draw
+ * command whose instanceCount is the live count, and the compaction counter.
+ * The GPU rewrites it every frame; the CPU only initialises it. */
+constexpr std::array<std::uint32_t, 8> INITIAL_STATE = {0, 1, 1, 4,
+                                                       0, 0, 0, 0};
+constexpr GLintptr STATE_DISPATCH_OFFSET = 0;
+constexpr GLintptr STATE_DRAW_OFFSET = 3 * sizeof(std::uint32_t);
+
+constexpr GLuint LOCAL_SIZE = 64;
+
+/* The compute passes of ParticleSystem::update(), in dispatch order. */
+export enum class ParticlePass : std::size_t {
+  Simulate,
+  Emit,
+  Finalize,
+};
+
+constexpr std::array<std::string_view, 3> PASS_SHADERS = {
+    "particle_simulate.comp", "particle_emit.comp", "particle_finalize.comp"};
+
+/* Source of one compute pass, for compiling it through a ShaderBatch or
+ * ProgramCache. */
+export std::array<ShaderSource, 1>
+particleComputeShaderSources(ParticlePass pass) noexcept {
+  const auto &pack = na_gl_render_particles_shaders::PACK;
+  auto name = PASS_SHADERS[static_cast<std::size_t>(pass)];
+  return {{{GL_COMPUTE_SHADER, pack.find(name)->source}}};
+}
+
+export std::array<ShaderFile, 1>
+particleComputeShaderFiles(ParticlePass pass) noexcept {
+  constexpr std::string_view dir = NA_GL_RENDER_PARTICLES_SHADER_DIR;
+  auto name = PASS_SHADERS[static_cast<std::size_t>(pass)];
+  return {{{GL_COMPUTE_SHADER, std::format("{}/{}", dir, name)}}};
+}
+
+/* Sources of the particle draw program. */
+export std::array<ShaderSource, 2> particleShaderSources() noexcept {
+  const auto &pack = na_gl_render_particles_shaders::PACK;
+  return {{
+      {GL_VERTEX_SHADER, pack.find("particle.vert")->source},
+      {GL_FRAGMENT_SHADER, pack.find("particle.frag")->source},
+  }};
+}
+
+export std::array<ShaderFile, 2> particleShaderFiles() noexcept {
+  constexpr std::string_view dir = NA_GL_RENDER_PARTICLES_SHADER_DIR;
+  return {{
+      {GL_VERTEX_SHADER, std::format("{}/particle.vert", dir)},
+      {GL_FRAGMENT_SHADER, std::format("{}/particle.frag", dir)},
+  }};
+}
+
+/* Programs built from particleComputeShaderSources() of each pass. */
+export struct ParticlePrograms {
+  const ShaderProgram *simulate;
+  const ShaderProgram *emit;
+  const ShaderProgram *finalize;
+};
+
+export struct ParticleSystemConfig {
+  /* Live particles beyond this are dropped at emission. */
+  std::size_t capacity = 65536;
+  glm::vec2 gravity{0.0f};
+};
+
+export struct ParticleBurstConfig {
+  glm::vec2 origin;
+  std::uint32_t count;
+  glm::vec4 color{1.0f};
+  /* Top speed in world units per second; each particle gets 25-100%. */
+  float speed = 1.0f;
+  /* Top lifetime in seconds; each particle gets 50-100%. */
+  float life = 1.0f;
+  float size = 1.0f;
+};
+
+/* Particles that live entirely on the GPU. Each update() integrates the live
+ * particles and compacts the survivors into the other of two SSBOs, appends
+ * the frame's bursts behind them, then publishes the new count into the
+ * dispatch and draw commands of a state buffer, so simulation and drawing go
+ * through glDispatchComputeIndirect and glDrawArraysIndirect and the CPU
+ * never touches or even counts individual particles. */
+export class ParticleSystem {
+  ParticleSystemConfig _config;
+  std::array<GLuint, 2> _particleBuffers{};
+  GLuint _stateBuffer{};
+  GLuint _frameBuffer{};
+  GLuint _vertexArray{};
+  ParticleFrame _frame{};
+  std::vector<ParticleBurstConfig> _bursts;
+  /* Index of the buffer holding the live particles. */
+  std::size_t _current = 0;
+  std::uint32_t _seed = 0;
+
+  explicit ParticleSystem(ParticleSystemConfig config) noexcept
+      : _config(config) {
+    _frame.set<"gravity">(config.gravity);
+  }
+
+  static Result<GLuint> createStorage(std::size_t size, const void *data,
+                                      GLbitfield flags) noexcept {
+    AUTO_RESULT(buffer, GL::instance().createBuffer());
+    if (auto storage = GL::instance().namedBufferStorage(
+            buffer, static_cast<GLsizeiptr>(size), data, flags);
+        storage.failed()) {
+      GL::instance().deleteBuffer(buffer);
+      return storage.errorWithPrefix("({}:{})", __FUNCTION__, __LINE__);
+    }
+    return buffer;
+  }
+
+  /* Moves up to MAX_BURSTS queued bursts into the frame block and returns
+   * how many particles they emit; the rest wait for the next update(). */
+  std::uint32_t takeBursts() noexcept {
+    auto count = std::min(_bursts.size(), MAX_BURSTS);
+    auto bursts = _frame.get<"bursts">();
+    std::uint32_t end = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+      const auto &burst = _bursts[i];
+      auto room = static_cast<std::uint32_t>(_config.capacity) - end;
+      end += std::min(burst.count, room);
+      bursts[i]
+          .set<"origin">(burst.origin)
+          .set<"speed">(burst.speed)
+          .set<"life">(burst.life)
+          .set<"color">(burst.color)
+          .set<"size">(burst.size)
+          .set<"end">(end);
+    }
+    _bursts.erase(_bursts.begin(),
+                  _bursts.begin() + static_cast<std::ptrdiff_t>(count));
+    _frame.set<"bursts">(bursts).set<"burstCount">(
+        static_cast<std::uint32_t>(count));
+    return end;
+  }
+
+public:
+  ParticleSystem(const ParticleSystem &) = delete;
+  ParticleSystem &operator=(const ParticleSystem &) = delete;
+
+  ~ParticleSystem() noexcept {
+    for (auto buffer : _particleBuffers) {
+      if (buffer != 0) {
+        GL::instance().deleteBuffer(buffer);
+      }
+    }
+    if (_stateBuffer != 0) {
+      GL::instance().deleteBuffer(_stateBuffer);
+    }
+    if (_frameBuffer != 0) {
+      GL::instance().deleteBuffer(_frameBuffer);
+    }
+    if (_vertexArray != 0) {
+      GL::instance().deleteVertexArray(_vertexArray);
+    }
+  }
+
+  static UniqueResult<ParticleSystem>
+  create(ParticleSystemConfig config = {}) noexcept {
+    auto system = std::unique_ptr<ParticleSystem>(new ParticleSystem(config));
+    for (auto &buffer : system->_particleBuffers) {
+      AUTO_RESULT(particles,
+                  createStorage(config.capacity * Particle::SIZE, nullptr, 0));
+      buffer = particles;
+    }
+    AUTO_RESULT(state, createStorage(sizeof(INITIAL_STATE),
+                                     INITIAL_STATE.data(), 0));
+    system->_stateBuffer = state;
+    AUTO_RESULT(frame, createStorage(ParticleFrame::SIZE, nullptr,
+                                     GL_DYNAMIC_STORAGE_BIT));
+    system->_frameBuffer = frame;
+    AUTO_RESULT(vertexArray, GL::instance().createVertexArray());
+    system->_vertexArray = vertexArray;
+    return system;
+  }
+
+  std::size_t capacity() const noexcept { return _config.capacity; }
+
+  /* Queues particles to be spawned by the next update(). */
+  void burst(const ParticleBurstConfig &burst) noexcept {
+    if (burst.count != 0) {
+      _bursts.push_back(burst);
+    }
+  }
+
+  /* Takes effect at the next update(). */
+  void setCamera(const glm::mat4 &view, const glm::mat4 &projection) noexcept {
+    _frame.set<"view">(view).set<"projection">(projection);
+  }
+
+  /* Advances the simulation by deltaTime seconds and spawns queued bursts. */
+  VoidResult update(float deltaTime,
+                    const ParticlePrograms &programs) noexcept {
+    auto emitted = takeBursts();
+    _frame.set<"deltaTime">(deltaTime).set<"seed">(++_seed);
+    CHECK_RESULT(GL::instance().namedBufferSubData(
+        _frameBuffer, 0, ParticleFrame::SIZE, &_frame));
+    auto next = 1 - _current;
+    CHECK_RESULT(
+        GL::instance().bindBufferBase(GL_UNIFORM_BUFFER, 0, _frameBuffer));
+    CHECK_RESULT(GL::instance().bindBufferBase(GL_SHADER_STORAGE_BUFFER, 0,
+                                               _particleBuffers[_current]));
+    CHECK_RESULT(GL::instance().bindBufferBase(GL_SHADER_STORAGE_BUFFER, 1,
+                                               _particleBuffers[next]));
+    CHECK_RESULT(GL::instance().bindBufferBase(GL_SHADER_STORAGE_BUFFER, 2,
+                                               _stateBuffer));
+    CHECK_RESULT(
+        GL::instance().bindBuffer(GL_DISPATCH_INDIRECT_BUFFER, _stateBuffer));
+
+    // Survivors first, then this frame's bursts behind them; each pass
+    // appends through the nextAlive counter.
+    CHECK_RESULT(GL::instance().useProgram(programs.simulate->id()));
+    CHECK_RESULT(GL::instance().dispatchComputeIndirect(STATE_DISPATCH_OFFSET));
+    CHECK_RESULT(GL::instance().memoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT));
+    if (emitted != 0) {
+      CHECK_RESULT(GL::instance().useProgram(programs.emit->id()));
+      CHECK_RESULT(GL::instance().dispatchCompute(
+          (emitted + LOCAL_SIZE - 1) / LOCAL_SIZE, 1, 1));
+      CHECK_RESULT(GL::instance().memoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT));
+    }
+    CHECK_RESULT(GL::instance().useProgram(programs.finalize->id()));
+    CHECK_RESULT(GL::instance().dispatchCompute(1, 1, 1));
+    CHECK_RESULT(GL::instance().memoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT |
+                                              GL_COMMAND_BARRIER_BIT));
+    _current = next;
+    return {};
+  }
+
+  /* Draws the live particles with one indirect instanced draw, blended
+   * additively over the frame, using a program built from
+   * particleShaderSources(). */
+  VoidResult draw(const ShaderProgram &program) noexcept {
+    CHECK_RESULT(GL::instance().useProgram(program.id()));
+    CHECK_RESULT(
+        GL::instance().bindBufferBase(GL_UNIFORM_BUFFER, 0, _frameBuffer));
+    CHECK_RESULT(GL::instance().bindBufferBase(GL_SHADER_STORAGE_BUFFER, 0,
+                                               _particleBuffers[_current]));
+    CHECK_RESULT(
+        GL::instance().bindBuffer(GL_DRAW_INDIRECT_BUFFER, _stateBuffer));
+    CHECK_RESULT(GL::instance().bindVertexArray(_vertexArray));
+    CHECK_RESULT(GL::instance().enable(GL_BLEND));
+    CHECK_RESULT(GL::instance().blendFunc(GL_ONE, GL_ONE));
+    auto drawn =
+        GL::instance().drawArraysIndirect(GL_TRIANGLE_FAN, STATE_DRAW_OFFSET);
+    CHECK_RESULT(GL::instance().disable(GL_BLEND));
+    return drawn;
+  }
+};
+
+} // namespace na::gl
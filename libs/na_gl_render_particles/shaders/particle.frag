@@ -0,0 +1,11 @@
+#version 450 core
+
+layout (location = 0) in vec4 inColor;
+layout (location = 1) in vec2 inCorner;
+layout (location = 0) out vec4 outColor;
+
+// A soft dot, premultiplied for additive blending.
+void main() {
+  float falloff = max(1.0 - dot(inCorner, inCorner), 0.0);
+  outColor = inColor * falloff;
+}
@@ -0,0 +1,33 @@
+#version 450 core
+
+#include "particle_common.glsl"
+
+layout (binding = 0, std430) readonly buffer Particles {
+  Particle particles[];
+};
+
+vec2 vertices[4] = vec2[](
+  vec2(-0.5, -0.5),
+  vec2(0.5, -0.5),
+  vec2(0.5, 0.5),
+  vec2(-0.5, 0.5)
+);
+
+layout (location = 0) out vec4 outColor;
+layout (location = 1) out vec2 outCorner;
+
+out gl_PerVertex {
+  vec4 gl_Position;
+};
+
+void main() {
+  Particle particle = particles[gl_InstanceID];
+  float age = particle.life / particle.maxLife;
+  vec2 corner = vertices[gl_VertexID];
+  float size = particle.size * (0.5 + 0.5 * age);
+  vec2 position = particle.position + corner * size;
+  vec4 color = unpackUnorm4x8(particle.color);
+  outColor = vec4(color.rgb * color.a * age, 0.0);
+  outCorner = corner * 2.0;
+  gl_Position = projection * view * vec4(position, 0.0, 1.0);
+}
@@ -0,0 +1,47 @@
+// Declarations shared by every particle pass. Matches Particle,
+// ParticleBurst, ParticleFrame and the state layout in particle_system.cpp.
+
+struct Particle {
+  vec2 position;
+  vec2 velocity;
+  uint color;
+  float life;
+  float maxLife;
+  float size;
+};
+
+struct ParticleBurst {
+  vec2 origin;
+  float speed;
+  float life;
+  vec4 color;
+  float size;
+  // Exclusive end of this burst's emit indices.
+  uint end;
+};
+
+const uint MAX_BURSTS = 16u;
+
+layout (binding = 0, std140) uniform ParticleFrame {
+  mat4 view;
+  mat4 projection;
+  vec2 gravity;
+  float deltaTime;
+  uint seed;
+  uint burstCount;
+  ParticleBurst bursts[MAX_BURSTS];
+};
+
+// A DispatchIndirectCommand for the simulate pass followed by a
+// DrawArraysIndirectCommand whose instanceCount is the live particle count,
+// and the counter the next generation is compacted with.
+layout (binding = 2, std430) buffer ParticleState {
+  uint dispatchX;
+  uint dispatchY;
+  uint dispatchZ;
+  uint drawCount;
+  uint alive;
+  uint drawFirst;
+  uint drawBaseInstance;
+  uint nextAlive;
+};
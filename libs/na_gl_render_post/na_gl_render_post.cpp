@@ -0,0 +1,4 @@
+export module na_gl_render_post;
+
+export import :post_chain;
+export import :post_effects;
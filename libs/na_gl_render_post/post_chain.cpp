@@ -0,0 +1,299 @@
+module;
+
+#include <algorithm>
+#include <cstddef>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <memory>
+#include <na_error/macros.hpp>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+export module na_gl_render_post:post_chain;
+
+import na_error;
+import na_gl;
+import na_gl_render_common;
+import na_gl_render_post_shaders;
+
+namespace na::gl {
+
+/* Input name of the image rendered between PostChain::begin() and end(). */
+export constexpr std::string_view POST_SCENE = "scene";
+
+export constexpr std::size_t MAX_POST_INPUTS = 2;
+
+export struct PostPassConfig {
+  std::string name;
+  /* GLSL fragment shader; its includes, usually post_common.glsl, resolve
+   * against the post shader pack. Only read by PostChain::create(). */
+  std::string_view fragment;
+  /* Output size as a fraction of the chain's output, for passes that can
+   * run at reduced resolution. Ignored for the last pass. */
+  float scale = 1.0f;
+  GLenum format = GL_RGBA16F;
+  /* Names of earlier passes or POST_SCENE, bound to units 0 and 1. Empty
+   * reads the previous pass. */
+  std::vector<std::string> inputs;
+  glm::vec4 parameters{0.0f};
+};
+
+export struct PostPassTiming {
+  std::string_view name;
+  double milliseconds;
+};
+
+/* A fixed list of full-screen passes applied to the scene. Every program is
+ * compiled and every input resolved once in create(). Each frame the
+ * intermediate targets come from a RenderTargetPool and go back to it right
+ * after their last reader, so consecutive passes ping-pong between a few
+ * textures and reduced-resolution passes cost only their own pixels. The
+ * last pass draws to the default framebuffer. */
+export class PostChain {
+  /* Index into _passes of the scene input. */
+  static constexpr std::size_t SCENE = static_cast<std::size_t>(-1);
+
+  struct Pass {
+    std::string name;
+    std::optional<ShaderProgram> program;
+    float scale;
+    GLenum format;
+    std::vector<std::size_t> inputs;
+    glm::vec4 parameters;
+    /* Last pass reading this one's output. */
+    std::size_t lastUse;
+  };
+
+  std::vector<Pass> _passes;
+  std::size_t _sceneLastUse = 0;
+  RenderTargetPool _pool;
+  std::unique_ptr<GpuTimer> _timer;
+  GLuint _vertexArray{};
+  GLsizei _width = 0;
+  GLsizei _height = 0;
+  RenderTarget _scene{};
+  RenderTarget _depth{};
+  std::vector<RenderTarget> _outputs;
+  std::vector<PostPassTiming> _timings;
+
+  explicit PostChain(RenderTargetPoolConfig poolConfig) noexcept
+      : _pool(poolConfig) {}
+
+  static Result<ShaderProgram>
+  createProgram(const PostPassConfig &config) noexcept {
+    const auto &pack = na_gl_render_post_shaders::PACK;
+    UNIQUE_RESULT(vertex,
+                  ShaderStage::create(GL_VERTEX_SHADER, config.name,
+                                      pack.find("post.vert")->source));
+    // Built-in passes come pre-expanded; caller-written ones may still
+    // include post_common.glsl.
+    ShaderPreprocessor preprocessor(
+        [&pack](std::string_view path) -> Result<std::string> {
+          AUTO_RESULT(source, pack.source(GL_FRAGMENT_SHADER, path));
+          return std::string(source.source);
+        });
+    UNIQUE_RESULT(expanded, preprocessor.process(config.name, config.fragment));
+    UNIQUE_RESULT(fragment, ShaderStage::create(GL_FRAGMENT_SHADER,
+                                                config.name, expanded.source));
+    return ShaderProgram::create({&vertex, &fragment}, config.name);
+  }
+
+  Result<std::size_t> resolveInput(std::size_t pass,
+                                   std::string_view name) const noexcept {
+    if (name == POST_SCENE) {
+      return SCENE;
+    }
+    for (std::size_t i = 0; i < pass; ++i) {
+      if (_passes[i].name == name) {
+        return i;
+      }
+    }
+    return SimpleError("post pass {} reads {}, which is not an earlier pass",
+                       _passes[pass].name, name);
+  }
+
+  const RenderTarget &input(std::size_t index) const noexcept {
+    return index == SCENE ? _scene : _outputs[index];
+  }
+
+  VoidResult runPass(std::size_t index, float time) noexcept {
+    auto &pass = _passes[index];
+    if (index + 1 == _passes.size()) {
+      CHECK_RESULT(GL::instance().bindFramebuffer(GL_DRAW_FRAMEBUFFER, 0));
+      CHECK_RESULT(GL::instance().viewport(0, 0, _width, _height));
+    } else {
+      auto width = std::max(static_cast<GLsizei>(_width * pass.scale), 1);
+      auto height = std::max(static_cast<GLsizei>(_height * pass.scale), 1);
+      AUTO_RESULT(output, _pool.acquire({width, height, pass.format}));
+      _outputs[index] = output;
+      AUTO_RESULT(framebuffer, _pool.framebuffer({&output, 1}, nullptr));
+      CHECK_RESULT(framebuffer->bind());
+      CHECK_RESULT(GL::instance().viewport(0, 0, width, height));
+    }
+    for (std::size_t unit = 0; unit < pass.inputs.size(); ++unit) {
+      CHECK_RESULT(GL::instance().bindTextureUnit(
+          static_cast<GLuint>(unit), input(pass.inputs[unit]).texture));
+    }
+    const auto &source = input(pass.inputs[0]).desc;
+    auto texelSize = 1.0f / glm::vec2(source.width, source.height);
+    CHECK_RESULT(pass.program->setUniform(hashString("texelSize"), texelSize));
+    CHECK_RESULT(pass.program->setUniform(hashString("time"), time));
+    CHECK_RESULT(
+        pass.program->setUniform(hashString("parameters"), pass.parameters));
+    CHECK_RESULT(pass.program->flushUniforms());
+    CHECK_RESULT(GL::instance().useProgram(pass.program->id()));
+    CHECK_RESULT(GL::instance().drawArrays(GL_TRIANGLES, 0, 3));
+
+    // The output above was acquired while the inputs were held, so a pass
+    // never samples the texture it renders to.
+    for (auto inputIndex : pass.inputs) {
+      if (inputIndex == SCENE) {
+        if (_sceneLastUse == index) {
+          _pool.release(_scene);
+        }
+      } else if (_passes[inputIndex].lastUse == index) {
+        _pool.release(_outputs[inputIndex]);
+      }
+    }
+    if (pass.lastUse == index && index + 1 != _passes.size()) {
+      _pool.release(_outputs[index]);
+    }
+    return _timer->mark();
+  }
+
+public:
+  PostChain(const PostChain &) = delete;
+  PostChain &operator=(const PostChain &) = delete;
+
+  ~PostChain() noexcept {
+    if (_vertexArray != 0) {
+      GL::instance().deleteVertexArray(_vertexArray);
+    }
+  }
+
+  static UniqueResult<PostChain>
+  create(std::span<const PostPassConfig> passes,
+         RenderTargetPoolConfig poolConfig = {}) noexcept {
+    if (passes.empty()) {
+      return SimpleError("post chain needs at least one pass");
+    }
+    auto chain = std::unique_ptr<PostChain>(new PostChain(poolConfig));
+    chain->_passes.reserve(passes.size());
+    for (std::size_t i = 0; i < passes.size(); ++i) {
+      const auto &config = passes[i];
+      if (config.scale <= 0.0f || config.scale > 1.0f) {
+        return SimpleError("post pass {} has scale {}, expected (0, 1]",
+                           config.name, config.scale);
+      }
+      if (config.inputs.size() > MAX_POST_INPUTS) {
+        return SimpleError("post pass {} has {} inputs, at most {}",
+                           config.name, config.inputs.size(),
+                           MAX_POST_INPUTS);
+      }
+      UNIQUE_RESULT(program, createProgram(config));
+      auto &pass = chain->_passes.emplace_back(Pass{
+          .name = config.name,
+          .program = std::nullopt,
+          .scale = config.scale,
+          .format = config.format,
+          .inputs = {},
+          .parameters = config.parameters,
+          .lastUse = i,
+      });
+      pass.program.emplace(std::move(program));
+      if (config.inputs.empty()) {
+        pass.inputs.push_back(i == 0 ? SCENE : i - 1);
+      }
+      for (const auto &name : config.inputs) {
+        AUTO_RESULT(inputIndex, chain->resolveInput(i, name));
+        pass.inputs.push_back(inputIndex);
+      }
+      for (auto inputIndex : pass.inputs) {
+        if (inputIndex == SCENE) {
+          chain->_sceneLastUse = i;
+        } else {
+          chain->_passes[inputIndex].lastUse = i;
+        }
+      }
+    }
+    chain->_outputs.resize(passes.size());
+    UNIQUE_RESULT(timer, GpuTimer::create(passes.size() + 1));
+    chain->_timer = std::move(timer);
+    AUTO_RESULT(vertexArray, GL::instance().createVertexArray());
+    chain->_vertexArray = vertexArray;
+    return chain;
+  }
+
+  /* Changes the parameters uniform of the named pass. */
+  VoidResult setParameters(std::string_view name,
+                           glm::vec4 parameters) noexcept {
+    for (auto &pass : _passes) {
+      if (pass.name == name) {
+        pass.parameters = parameters;
+        return {};
+      }
+    }
+    return SimpleError("no post pass named {}", name);
+  }
+
+  /* Binds a width x height color and depth target for the scene; draw it
+   * between begin() and end(). */
+  VoidResult begin(GLsizei width, GLsizei height) noexcept {
+    _width = width;
+    _height = height;
+    _pool.beginFrame();
+    CHECK_RESULT(_timer->beginFrame());
+    AUTO_RESULT(scene, _pool.acquire({width, height, GL_RGBA16F}));
+    _scene = scene;
+    AUTO_RESULT(depth, _pool.acquire({width, height, GL_DEPTH_COMPONENT24}));
+    _depth = depth;
+    AUTO_RESULT(framebuffer, _pool.framebuffer({&_scene, 1}, &_depth));
+    CHECK_RESULT(framebuffer->bind());
+    return GL::instance().viewport(0, 0, width, height);
+  }
+
+  /* Runs every pass and leaves the default framebuffer bound with blending
+   * and the depth test disabled. */
+  VoidResult end(float time = 0.0f) noexcept {
+    _pool.release(_depth);
+    CHECK_RESULT(GL::instance().disable(GL_BLEND));
+    CHECK_RESULT(GL::instance().disable(GL_DEPTH_TEST));
+    CHECK_RESULT(GL::instance().bindVertexArray(_vertexArray));
+    CHECK_RESULT(_timer->mark());
+    for (std::size_t i = 0; i < _passes.size(); ++i) {
+      CHECK_RESULT(runPass(i, time));
+    }
+    auto intervals = _timer->intervals();
+    if (intervals.size() == _passes.size()) {
+      _timings.resize(_passes.size());
+      for (std::size_t i = 0; i < _passes.size(); ++i) {
+        _timings[i] = {_passes[i].name, intervals[i]};
+      }
+    }
+    return {};
+  }
+
+  /* GPU time of each pass from a recent frame; empty until the first
+   * results arrive a frame or two after the first end(). */
+  std::span<const PostPassTiming> timings() const noexcept {
+    return _timings;
+  }
+
+  /* Sum of timings(), for budgeting the chain as a whole. */
+  double totalMilliseconds() const noexcept {
+    double total = 0.0;
+    for (const auto &timing : _timings) {
+      total += timing.milliseconds;
+    }
+    return total;
+  }
+
+  const RenderTargetPoolStats &poolStats() const noexcept {
+    return _pool.stats();
+  }
+};
+
+} // namespace na::gl
@@ -0,0 +1,93 @@
+module;
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+
+export module na_gl_render_post:post_effects;
+
+import na_gl_render_post_shaders;
+import :post_chain;
+
+namespace na::gl {
+
+export struct BloomConfig {
+  /* Scene luminance where highlights start to glow. */
+  float threshold = 1.0f;
+  /* Width of the soft transition around threshold. */
+  float knee = 0.5f;
+  float intensity = 0.8f;
+};
+
+export struct VignetteConfig {
+  float strength = 0.5f;
+  /* Distance from the centre, 1 at the corners, where darkening starts. */
+  float radius = 0.5f;
+};
+
+export struct CrtConfig {
+  float curvature = 0.06f;
+  /* How much every other row is darkened. */
+  float scanlines = 0.25f;
+  /* Red and blue offset in source texels. */
+  float channelSplit = 1.0f;
+};
+
+/* Bright pass at half resolution, downsampled to a quarter for a separable
+ * blur, tent-upsampled back to half and added to the scene. The bloom
+ * targets are R11G11B10F, half the bandwidth of RGBA16F. */
+export std::vector<PostPassConfig>
+bloomPasses(BloomConfig config = {}) noexcept {
+  const auto &pack = na_gl_render_post_shaders::PACK;
+  constexpr GLenum FORMAT = GL_R11F_G11F_B10F;
+  return {
+      {.name = "bloom-threshold",
+       .fragment = pack.find("post_threshold.frag")->source,
+       .scale = 0.5f,
+       .format = FORMAT,
+       .inputs = {std::string(POST_SCENE)},
+       .parameters = {config.threshold, config.knee, 0.0f, 0.0f}},
+      {.name = "bloom-downsample",
+       .fragment = pack.find("post_downsample.frag")->source,
+       .scale = 0.25f,
+       .format = FORMAT},
+      {.name = "bloom-blur-x",
+       .fragment = pack.find("post_blur.frag")->source,
+       .scale = 0.25f,
+       .format = FORMAT,
+       .parameters = {1.0f, 0.0f, 0.0f, 0.0f}},
+      {.name = "bloom-blur-y",
+       .fragment = pack.find("post_blur.frag")->source,
+       .scale = 0.25f,
+       .format = FORMAT,
+       .parameters = {0.0f, 1.0f, 0.0f, 0.0f}},
+      {.name = "bloom-upsample",
+       .fragment = pack.find("post_upsample.frag")->source,
+       .scale = 0.5f,
+       .format = FORMAT,
+       .inputs = {"bloom-blur-y", "bloom-threshold"}},
+      {.name = "bloom",
+       .fragment = pack.find("post_bloom.frag")->source,
+       .inputs = {std::string(POST_SCENE), "bloom-upsample"},
+       .parameters = {config.intensity, 0.0f, 0.0f, 0.0f}},
+  };
+}
+
+export PostPassConfig vignettePass(VignetteConfig config = {}) noexcept {
+  const auto &pack = na_gl_render_post_shaders::PACK;
+  return {.name = "vignette",
+          .fragment = pack.find("post_vignette.frag")->source,
+          .parameters = {config.strength, config.radius, 0.0f, 0.0f}};
+}
+
+/* Clamps to [0, 1], so it belongs at the end of the chain. */
+export PostPassConfig crtPass(CrtConfig config = {}) noexcept {
+  const auto &pack = na_gl_render_post_shaders::PACK;
+  return {.name = "crt",
+          .fragment = pack.find("post_crt.frag")->source,
+          .parameters = {config.curvature, config.scanlines,
+                         config.channelSplit, 0.0f}};
+}
+
+} // namespace na::gl
@@ -0,0 +1,14 @@
+#version 450 core
+
+layout (location = 0) out vec2 outUv;
+
+out gl_PerVertex {
+  vec4 gl_Position;
+};
+
+// One triangle covering the viewport; no vertex buffer is bound.
+void main() {
+  vec2 corner = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+  outUv = corner;
+  gl_Position = vec4(corner * 2.0 - 1.0, 0.0, 1.0);
+}
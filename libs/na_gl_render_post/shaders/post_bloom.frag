@@ -0,0 +1,11 @@
+#version 450 core
+
+#include "post_common.glsl"
+
+// Adds the blurred highlights in auxiliary to the scene, scaled by
+// parameters.x.
+void main() {
+  vec4 scene = texture(source, inUv);
+  vec3 bloom = texture(auxiliary, inUv).rgb * parameters.x;
+  outColor = vec4(scene.rgb + bloom, scene.a);
+}
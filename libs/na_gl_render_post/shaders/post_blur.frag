@@ -0,0 +1,18 @@
+#version 450 core
+
+#include "post_common.glsl"
+
+// One axis of a 9-tap Gaussian in five bilinear taps; parameters.xy is the
+// axis.
+const float OFFSETS[3] = float[](0.0, 1.3846153846, 3.2307692308);
+const float WEIGHTS[3] = float[](0.2270270270, 0.3162162162, 0.0702702703);
+
+void main() {
+  vec2 axis = parameters.xy * texelSize;
+  vec3 color = texture(source, inUv).rgb * WEIGHTS[0];
+  for (int i = 1; i < 3; ++i) {
+    color += texture(source, inUv + axis * OFFSETS[i]).rgb * WEIGHTS[i];
+    color += texture(source, inUv - axis * OFFSETS[i]).rgb * WEIGHTS[i];
+  }
+  outColor = vec4(color, 1.0);
+}
@@ -0,0 +1,18 @@
+// Inputs of a post pass, bound by PostChain: the pass's first input at unit
+// 0 and its second, if any, at unit 1.
+layout (binding = 0) uniform sampler2D source;
+layout (binding = 1) uniform sampler2D auxiliary;
+
+// Size of one texel of source.
+uniform vec2 texelSize;
+// Seconds, as passed to PostChain::end().
+uniform float time;
+// Per-pass settings from PostPassConfig::parameters.
+uniform vec4 parameters;
+
+layout (location = 0) in vec2 inUv;
+layout (location = 0) out vec4 outColor;
+
+float luminance(vec3 color) {
+  return dot(color, vec3(0.2126, 0.7152, 0.0722));
+}
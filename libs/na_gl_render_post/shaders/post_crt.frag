@@ -0,0 +1,21 @@
+#version 450 core
+
+#include "post_common.glsl"
+
+// Curves the picture like a tube by parameters.x, splits the channels by
+// parameters.z texels and darkens every other output row by parameters.y.
+void main() {
+  vec2 centered = inUv * 2.0 - 1.0;
+  centered *= 1.0 + dot(centered, centered) * parameters.x;
+  vec2 uv = centered * 0.5 + 0.5;
+  if (any(lessThan(uv, vec2(0.0))) || any(greaterThan(uv, vec2(1.0)))) {
+    outColor = vec4(0.0, 0.0, 0.0, 1.0);
+    return;
+  }
+  vec2 split = vec2(parameters.z * texelSize.x, 0.0);
+  vec3 color = vec3(texture(source, uv - split).r, texture(source, uv).g,
+                    texture(source, uv + split).b);
+  float row = gl_FragCoord.y * 0.5;
+  float scanline = 1.0 - parameters.y * step(0.5, fract(row));
+  outColor = vec4(clamp(color * scanline, 0.0, 1.0), 1.0);
+}
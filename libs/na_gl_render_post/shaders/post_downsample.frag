@@ -0,0 +1,13 @@
+#version 450 core
+
+#include "post_common.glsl"
+
+// Four bilinear taps average a 4x4 block of source.
+void main() {
+  vec2 offset = texelSize;
+  vec3 color = texture(source, inUv + vec2(-offset.x, -offset.y)).rgb +
+               texture(source, inUv + vec2(offset.x, -offset.y)).rgb +
+               texture(source, inUv + vec2(-offset.x, offset.y)).rgb +
+               texture(source, inUv + vec2(offset.x, offset.y)).rgb;
+  outColor = vec4(color * 0.25, 1.0);
+}
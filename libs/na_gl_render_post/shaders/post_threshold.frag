@@ -0,0 +1,20 @@
+#version 450 core
+
+#include "post_common.glsl"
+
+// Keeps what is brighter than parameters.x with a soft knee of parameters.y,
+// averaging a 4x4 block of source into each output texel.
+void main() {
+  vec2 offset = texelSize;
+  vec3 color = (texture(source, inUv + vec2(-offset.x, -offset.y)).rgb +
+                texture(source, inUv + vec2(offset.x, -offset.y)).rgb +
+                texture(source, inUv + vec2(-offset.x, offset.y)).rgb +
+                texture(source, inUv + vec2(offset.x, offset.y)).rgb) * 0.25;
+  float threshold = parameters.x;
+  float knee = max(parameters.y, 1e-4);
+  float brightness = luminance(color);
+  float soft = clamp(brightness - threshold + knee, 0.0, 2.0 * knee);
+  soft = soft * soft / (4.0 * knee);
+  float weight = max(soft, brightness - threshold) / max(brightness, 1e-4);
+  outColor = vec4(color * weight, 1.0);
+}
@@ -0,0 +1,19 @@
+#version 450 core
+
+#include "post_common.glsl"
+
+// A 3x3 tent filter over the low-resolution source, added to the
+// higher-resolution level in auxiliary.
+void main() {
+  vec2 offset = texelSize;
+  vec3 color = texture(source, inUv).rgb * 4.0;
+  color += (texture(source, inUv + vec2(-offset.x, 0.0)).rgb +
+            texture(source, inUv + vec2(offset.x, 0.0)).rgb +
+            texture(source, inUv + vec2(0.0, -offset.y)).rgb +
+            texture(source, inUv + vec2(0.0, offset.y)).rgb) * 2.0;
+  color += texture(source, inUv + vec2(-offset.x, -offset.y)).rgb +
+           texture(source, inUv + vec2(offset.x, -offset.y)).rgb +
+           texture(source, inUv + vec2(-offset.x, offset.y)).rgb +
+           texture(source, inUv + vec2(offset.x, offset.y)).rgb;
+  outColor = vec4(color / 16.0 + texture(auxiliary, inUv).rgb, 1.0);
+}
@@ -0,0 +1,12 @@
+#version 450 core
+
+#include "post_common.glsl"
+
+// Darkens towards the corners: parameters.x is the strength, parameters.y
+// the distance from the centre where darkening starts.
+void main() {
+  vec4 color = texture(source, inUv);
+  float edge = length(inUv - 0.5) * 1.41421356;
+  float shade = smoothstep(parameters.y, 1.0, edge) * parameters.x;
+  outColor = vec4(color.rgb * (1.0 - shade), color.a);
+}
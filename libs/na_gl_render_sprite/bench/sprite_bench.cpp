@@ -0,0 +1,245 @@
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <format>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <iostream>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <na_error/macros.hpp>
+
+import na_error;
+import na_glfwapp;
+import na_gl;
+import na_gl_render_common;
+import na_gl_render_sprite;
+import na_jobs;
+
+/* Measures sprite throughput at several instance counts for both instance
+ * formats, and for the full format filled by worker threads: the CPU cost of
+ * writing instances and submitting draws, and the whole frame including GPU
+ * work (glFinish before the swap). The overdraw rows stack OVERDRAW_LAYERS
+ * screen-covering layers submitted back-to-front, drawn in that order and
+ * then with depth sorting, to show the fill rate early-Z saves. */
+
+constexpr std::array<std::size_t, 3> SPRITE_COUNTS = {10'000, 100'000,
+                                                      1'000'000};
+constexpr std::array<std::string_view, 5> FORMATS = {
+    "full", "compact", "parallel", "overdraw", "overdraw-z"};
+/* Instances per parallelFor chunk: large enough to amortise claiming it,
+ * small enough to balance across workers. */
+constexpr std::size_t FILL_GRAIN = 4096;
+constexpr std::size_t OVERDRAW_LAYERS = 8;
+constexpr int WARMUP_FRAMES = 10;
+constexpr int MEASURED_FRAMES = 60;
+constexpr int SIZE = 1024;
+
+using Clock = std::chrono::steady_clock;
+using Milliseconds = std::chrono::duration<double, std::milli>;
+
+class SpriteBench : public na::GlfwApplication {
+  std::unique_ptr<na::gl::ShaderProgram> _program;
+  std::unique_ptr<na::gl::ShaderProgram> _compactProgram;
+  std::unique_ptr<na::gl::SpriteRenderer> _renderer;
+  std::unique_ptr<na::gl::CompactSpriteRenderer> _compactRenderer;
+  std::unique_ptr<na::gl::TextureAtlas> _atlas;
+  std::unique_ptr<na::ThreadPool> _pool;
+  std::size_t _run = 0;
+  int _frame = 0;
+  Milliseconds _submitTime{};
+  Milliseconds _frameTime{};
+
+  static na::Result<na::gl::ShaderProgram>
+  createProgram(const std::string &name,
+                std::span<const na::gl::ShaderSource, 2> sources) noexcept {
+    UNIQUE_RESULT(vertex, na::gl::ShaderStage::create(sources[0].type, name,
+                                                      sources[0].source));
+    UNIQUE_RESULT(fragment, na::gl::ShaderStage::create(sources[1].type, name,
+                                                        sources[1].source));
+    return na::gl::ShaderProgram::create({&vertex, &fragment}, name);
+  }
+
+  static void writeInstances(std::span<na::gl::SpriteInstance> instances,
+                             std::size_t begin, std::size_t end, float time,
+                             float z = 0.0f) noexcept {
+    auto columns = static_cast<std::size_t>(std::sqrt(instances.size())) + 1;
+    auto spacing = static_cast<float>(SIZE) / static_cast<float>(columns);
+    for (auto i = begin; i < end; ++i) {
+      auto x = static_cast<float>(i % columns) * spacing;
+      auto y = static_cast<float>(i / columns) * spacing;
+      auto local = glm::translate(glm::mat4(1.0f), glm::vec3(x, y, z));
+      local = glm::rotate(local, time + static_cast<float>(i),
+                          glm::vec3(0.0f, 0.0f, 1.0f));
+      local = glm::scale(local, glm::vec3(spacing, spacing, 1.0f));
+      instances[i]
+          .set<"local">(local)
+          .set<"tint">(glm::vec4(x / SIZE, y / SIZE, 0.5f, 1.0f));
+    }
+  }
+
+  /* With a pool, workers write straight into the mapped stream and the GL
+   * thread helps until the last chunk is done, then draws. */
+  void fill(std::size_t count, float time, na::ThreadPool *pool) noexcept {
+    na::gl::SpriteMaterial material{.program = _program.get()};
+    auto instances = _renderer->allocate(material, count);
+    if (pool == nullptr) {
+      writeInstances(instances, 0, instances.size(), time);
+      return;
+    }
+    pool->parallelFor(instances.size(), FILL_GRAIN,
+                      [=](std::size_t begin, std::size_t end) noexcept {
+                        writeInstances(instances, begin, end, time);
+                      })
+        .wait();
+  }
+
+  /* Layers farthest first, each covering the screen once, so painting them
+   * in order shades every pixel OVERDRAW_LAYERS times. */
+  void fillLayers(std::size_t count, float time) noexcept {
+    na::gl::SpriteMaterial material{.program = _program.get()};
+    auto perLayer = count / OVERDRAW_LAYERS;
+    for (std::size_t layer = 0; layer < OVERDRAW_LAYERS; ++layer) {
+      auto z = -0.8f + 0.2f * static_cast<float>(layer);
+      auto instances = _renderer->allocate(material, perLayer, z);
+      writeInstances(instances, 0, instances.size(), time, z);
+    }
+  }
+
+  void fillCompact(std::size_t count, float time) noexcept {
+    na::gl::SpriteMaterial material{.program = _compactProgram.get()};
+    auto instances = _compactRenderer->allocate(material, count);
+    auto columns = static_cast<std::size_t>(std::sqrt(count)) + 1;
+    auto spacing = static_cast<float>(SIZE) / static_cast<float>(columns);
+    for (std::size_t i = 0; i < instances.size(); ++i) {
+      auto x = static_cast<float>(i % columns) * spacing;
+      auto y = static_cast<float>(i / columns) * spacing;
+      instances[i] = na::gl::compactSprite(
+          glm::vec2(x, y), glm::vec2(spacing), time + static_cast<float>(i),
+          glm::vec4(x / SIZE, y / SIZE, 0.5f, 1.0f));
+    }
+  }
+
+  const na::gl::SpriteRendererStats &stats() const noexcept {
+    return _run % FORMATS.size() == 1 ? _compactRenderer->stats()
+                                      : _renderer->stats();
+  }
+
+public:
+  na::VoidResult onInit(const na::GlfwApplicationState &) noexcept override {
+    UNIQUE_RESULT(program,
+                  createProgram("sprite", na::gl::spriteShaderSources()));
+    _program = std::make_unique<na::gl::ShaderProgram>(std::move(program));
+    UNIQUE_RESULT(compactProgram,
+                  createProgram("sprite_compact",
+                                na::gl::compactSpriteShaderSources()));
+    _compactProgram =
+        std::make_unique<na::gl::ShaderProgram>(std::move(compactProgram));
+
+    na::gl::SpriteRendererConfig config{.initialCapacity =
+                                            SPRITE_COUNTS.back()};
+    UNIQUE_RESULT(renderer, na::gl::SpriteRenderer::create(config));
+    _renderer = std::move(renderer);
+    UNIQUE_RESULT(compactRenderer,
+                  na::gl::CompactSpriteRenderer::create(config));
+    _compactRenderer = std::move(compactRenderer);
+    // Only the white region: compact sprites sample it like a real atlas.
+    UNIQUE_RESULT(atlas, na::gl::TextureAtlas::create({.size = 64}));
+    _atlas = std::move(atlas);
+    UNIQUE_RESULT(pool, na::ThreadPool::create());
+    _pool = std::move(pool);
+    auto projection = glm::ortho(0.0f, static_cast<float>(SIZE), 0.0f,
+                                 static_cast<float>(SIZE));
+    _renderer->setCamera(glm::mat4(1.0f), projection);
+    _compactRenderer->setCamera(glm::mat4(1.0f), projection);
+    std::cout << std::format("{:>10} {:>6} {:>10} {:>12} {:>12} {:>12}",
+                             "format", "bytes", "sprites", "submit ms",
+                             "frame ms", "sprites/ms")
+              << std::endl;
+    return {};
+  }
+
+  na::VoidResult
+  onUpdate(const na::GlfwApplicationState &state) noexcept override {
+    auto count = SPRITE_COUNTS[_run / FORMATS.size()];
+    auto compact = _run % FORMATS.size() == 1;
+    auto parallel = _run % FORMATS.size() == 2;
+    auto overdraw = _run % FORMATS.size() >= 3;
+    auto start = Clock::now();
+    CHECK_RESULT(na::GL::instance().viewport(0, 0, state.width, state.height));
+    na::GL::instance().clearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    CHECK_RESULT(
+        na::GL::instance().clear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
+    auto time = static_cast<float>(state.frame) * 0.01f;
+    if (compact) {
+      CHECK_RESULT(_compactRenderer->begin());
+      fillCompact(count, time);
+      CHECK_RESULT(_atlas->bind());
+      CHECK_RESULT(_compactRenderer->end());
+    } else if (overdraw) {
+      _renderer->setDepthSorting(_run % FORMATS.size() == 4);
+      CHECK_RESULT(_renderer->begin());
+      fillLayers(count, time);
+      CHECK_RESULT(_renderer->end());
+      _renderer->setDepthSorting(false);
+    } else {
+      CHECK_RESULT(_renderer->begin());
+      fill(count, time, parallel ? _pool.get() : nullptr);
+      CHECK_RESULT(_renderer->end());
+    }
+    auto submitted = Clock::now();
+    CHECK_RESULT(na::GL::instance().finish());
+    auto finished = Clock::now();
+
+    if (stats().dropped != 0) {
+      return na::SimpleError("dropped {} sprites at {}", stats().dropped,
+                             count);
+    }
+    if (++_frame <= WARMUP_FRAMES) {
+      return {};
+    }
+    _submitTime += submitted - start;
+    _frameTime += finished - start;
+    if (_frame < WARMUP_FRAMES + MEASURED_FRAMES) {
+      return {};
+    }
+    auto submitMs = _submitTime.count() / MEASURED_FRAMES;
+    auto frameMs = _frameTime.count() / MEASURED_FRAMES;
+    auto bytes = compact ? na::gl::CompactSpriteInstance::SIZE
+                         : na::gl::SpriteInstance::SIZE;
+    std::cout << std::format(
+                     "{:>10} {:>6} {:>10} {:>12.3f} {:>12.3f} {:>12.1f}",
+                     FORMATS[_run % FORMATS.size()], bytes, count, submitMs,
+                     frameMs, static_cast<double>(count) / frameMs)
+              << std::endl;
+    _run++;
+    _frame = 0;
+    _submitTime = {};
+    _frameTime = {};
+    return {};
+  }
+
+  bool shouldClose() const noexcept override {
+    return _run == SPRITE_COUNTS.size() * FORMATS.size();
+  }
+};
+
+int main() noexcept {
+  SpriteBench bench{};
+  na::GlfwApplicationConfig config{
+      .title = "Gamedev 101: sprite benchmark",
+      .width = SIZE,
+      .height = SIZE,
+      .vsync = false,
+  };
+  auto result = na::runGlfwApplication(config, bench);
+  if (!result.ok()) {
+    std::cerr << "Error: " << result.error().message() << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,88 @@
+module;
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <format>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+#include <string_view>
+
+export module na_gl_render_sprite:compact_sprite;
+
+import na_gl_render_common;
+import na_gl_render_sprite_shaders;
+import :sprite_animation;
+
+namespace na::gl {
+
+/* Matches "CompactInstance" in sprite_compact.vert: a 2D sprite in 24 bytes
+ * instead of SpriteInstance's 80. scale holds two halves, rotationLayer a
+ * unorm16 angle in the low half and the AtlasRegionId in the high half, tint
+ * RGBA8. With SPRITE_CLIP_BIT set the high half is a SpriteClipId instead,
+ * and startTime is when the clip started playing, in Shared time. */
+export using CompactSpriteInstance =
+    GpuStruct<"CompactInstance", GpuLayoutRule::Std430,
+              GpuField<"position", glm::vec2>, GpuField<"scale", std::uint32_t>,
+              GpuField<"rotationLayer", std::uint32_t>,
+              GpuField<"tint", std::uint32_t>,
+              GpuField<"startTime", float>>;
+
+static_assert(CompactSpriteInstance::SIZE == 24);
+
+/* Encodes a sprite centred on position; rotation is in radians and wraps to
+ * one turn with 2^-16 precision. Region 0 is the atlas's white texel. */
+export CompactSpriteInstance compactSprite(glm::vec2 position, glm::vec2 scale,
+                                           float rotation, glm::vec4 tint,
+                                           std::uint16_t region = 0) noexcept {
+  constexpr float TURNS_PER_RADIAN = 0.15915494309189535f;
+  auto turns = rotation * TURNS_PER_RADIAN;
+  turns -= std::floor(turns);
+  CompactSpriteInstance instance;
+  instance.set<"position">(position)
+      .set<"scale">(glm::packHalf2x16(scale))
+      .set<"rotationLayer">(std::uint32_t{glm::packUnorm1x16(turns)} |
+                            std::uint32_t{region} << 16)
+      .set<"tint">(glm::packUnorm4x8(tint));
+  return instance;
+}
+
+/* A sprite that plays a clip from SpriteClips, starting at startTime in the
+ * renderer's time (BasicSpriteRenderer::setTime()). */
+export CompactSpriteInstance animatedSprite(glm::vec2 position, glm::vec2 scale,
+                                            float rotation, glm::vec4 tint,
+                                            SpriteClipId clip,
+                                            float startTime) noexcept {
+  auto instance =
+      compactSprite(position, scale, rotation, tint,
+                    static_cast<std::uint16_t>(clip | SPRITE_CLIP_BIT));
+  instance.set<"startTime">(startTime);
+  return instance;
+}
+
+/* Sources of the compact sprite program, which samples a TextureAtlas bound
+ * with TextureAtlas::bind(). */
+export std::array<ShaderSource, 2> compactSpriteShaderSources() noexcept {
+  const auto &pack = na_gl_render_sprite_shaders::PACK;
+  return {{
+      {GL_VERTEX_SHADER, pack.find("sprite_compact.vert")->source},
+      {GL_FRAGMENT_SHADER, pack.find("sprite_compact.frag")->source},
+  }};
+}
+
+/* The compute shader for culling compact sprites. */
+export ShaderSource compactSpriteCullShaderSource() noexcept {
+  const auto &pack = na_gl_render_sprite_shaders::PACK;
+  return {GL_COMPUTE_SHADER, pack.find("sprite_compact_cull.comp")->source};
+}
+
+export std::array<ShaderFile, 2> compactSpriteShaderFiles() noexcept {
+  constexpr std::string_view dir = NA_GL_RENDER_SPRITE_SHADER_DIR;
+  return {{
+      {GL_VERTEX_SHADER, std::format("{}/sprite_compact.vert", dir)},
+      {GL_FRAGMENT_SHADER, std::format("{}/sprite_compact.frag", dir)},
+  }};
+}
+
+} // namespace na::gl
@@ -0,0 +1,8 @@
+export module na_gl_render_sprite;
+
+export import :compact_sprite;
+export import :sprite_animation;
+export import :sprite_renderer;
+export import :static_sprite_batch;
+export import :texture_atlas;
+export import :tilemap;
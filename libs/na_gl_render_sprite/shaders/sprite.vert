@@ -0,0 +1,36 @@
+#version 450 core
+
+struct Instance {
+  mat4 local;
+  vec4 tint;
+};
+
+layout (binding = 0) uniform Shared {
+  mat4 view;
+  mat4 projection;
+};
+
+layout (binding = 0, std430) buffer Instances {
+  Instance instances[];
+};
+
+vec2 vertices[4] = vec2[](
+  vec2(-0.5, -0.5),
+  vec2(0.5, -0.5),
+  vec2(0.5, 0.5),
+  vec2(-0.5, 0.5)
+);
+
+layout (location = 0) out vec4 outTint;
+
+// Required to use this stage from a separable program.
+out gl_PerVertex {
+  vec4 gl_Position;
+};
+
+void main() {
+  Instance instance = instances[gl_InstanceID];
+  vec4 position = instance.local * vec4(vertices[gl_VertexID], 0.0, 1.0);
+  outTint = instance.tint;
+  gl_Position = projection * view * position;
+}
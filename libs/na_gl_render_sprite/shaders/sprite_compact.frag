@@ -0,0 +1,11 @@
+#version 450 core
+
+layout (binding = 0) uniform sampler2DArray atlas;
+
+layout (location = 0) in vec4 inTint;
+layout (location = 1) in vec3 inTexCoord;
+layout (location = 0) out vec4 outColor;
+
+void main() {
+  outColor = texture(atlas, inTexCoord) * inTint;
+}
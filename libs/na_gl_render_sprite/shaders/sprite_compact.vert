@@ -0,0 +1,105 @@
+#version 450 core
+
+struct CompactInstance {
+  vec2 position;
+  uint scale;
+  uint rotationLayer;
+  uint tint;
+  float startTime;
+};
+
+layout (binding = 0) uniform Shared {
+  mat4 view;
+  mat4 projection;
+  float time;
+};
+
+// Depth of the run being drawn; instances carry no z of their own.
+layout (location = 0) uniform float runDepth;
+
+layout (binding = 0, std430) buffer CompactInstances {
+  CompactInstance instances[];
+};
+
+struct AtlasRegion {
+  vec4 uv;
+  uint layer;
+};
+
+layout (binding = 1, std430) readonly buffer AtlasRegions {
+  AtlasRegion regions[];
+};
+
+struct SpriteClip {
+  uint firstFrame;
+  uint frameCount;
+  float frameRate;
+  uint loop;
+};
+
+layout (binding = 4, std430) readonly buffer SpriteClips {
+  SpriteClip clips[];
+};
+
+layout (binding = 5, std430) readonly buffer SpriteClipFrames {
+  uint frames[];
+};
+
+const uint CLIP_BIT = 0x8000u;
+const uint LOOP_ONCE = 0u;
+const uint LOOP_REPEAT = 1u;
+
+vec2 vertices[4] = vec2[](
+  vec2(-0.5, -0.5),
+  vec2(0.5, -0.5),
+  vec2(0.5, 0.5),
+  vec2(-0.5, 0.5)
+);
+
+const float RADIANS_PER_STEP = 6.283185307179586 / 65535.0;
+
+// The atlas region to show: the instance's own, or its clip's current frame.
+uint currentRegion(CompactInstance instance) {
+  uint region = instance.rotationLayer >> 16;
+  if ((region & CLIP_BIT) == 0u) {
+    return region;
+  }
+  SpriteClip clip = clips[region & ~CLIP_BIT];
+  float elapsed = max(time - instance.startTime, 0.0);
+  uint frame = uint(elapsed * clip.frameRate);
+  if (clip.loop == LOOP_ONCE) {
+    frame = min(frame, clip.frameCount - 1u);
+  } else if (clip.loop == LOOP_REPEAT || clip.frameCount < 3u) {
+    frame %= clip.frameCount;
+  } else {
+    uint period = 2u * clip.frameCount - 2u;
+    frame %= period;
+    frame = frame < clip.frameCount ? frame : period - frame;
+  }
+  return frames[clip.firstFrame + frame];
+}
+
+layout (location = 0) out vec4 outTint;
+layout (location = 1) out vec3 outTexCoord;
+
+// Required to use this stage from a separable program.
+out gl_PerVertex {
+  vec4 gl_Position;
+};
+
+void main() {
+  CompactInstance instance = instances[gl_InstanceID];
+  vec2 corner = vertices[gl_VertexID] * unpackHalf2x16(instance.scale);
+  float angle = float(instance.rotationLayer & 0xffffu) * RADIANS_PER_STEP;
+  float c = cos(angle);
+  float s = sin(angle);
+  vec2 position = instance.position +
+                  vec2(c * corner.x - s * corner.y, s * corner.x + c * corner.y);
+  outTint = unpackUnorm4x8(instance.tint);
+  AtlasRegion region = regions[currentRegion(instance)];
+  vec2 t = vertices[gl_VertexID] + 0.5;
+  // Images are stored top row first while y points up on screen.
+  outTexCoord = vec3(mix(region.uv.xy, region.uv.zw, vec2(t.x, 1.0 - t.y)),
+                     float(region.layer));
+  gl_Position = projection * view * vec4(position, runDepth, 1.0);
+}
@@ -0,0 +1,29 @@
+#version 450 core
+
+layout (binding = 0) uniform sampler2DArray atlas;
+layout (binding = 1) uniform usampler2D cells;
+
+struct AtlasRegion {
+  vec4 uv;
+  uint layer;
+};
+
+layout (binding = 1, std430) readonly buffer AtlasRegions {
+  AtlasRegion regions[];
+};
+
+layout (location = 0) in vec2 inCell;
+layout (location = 0) out vec4 outColor;
+
+void main() {
+  ivec2 cell = min(ivec2(inCell), textureSize(cells, 0) - 1);
+  uint tile = texelFetch(cells, cell, 0).r;
+  if (tile == 0u) {
+    discard;
+  }
+  AtlasRegion region = regions[tile];
+  vec2 texel = inCell - vec2(cell);
+  // Images are stored top row first while y points up on screen.
+  vec2 uv = mix(region.uv.xy, region.uv.zw, vec2(texel.x, 1.0 - texel.y));
+  outColor = texture(atlas, vec3(uv, float(region.layer)));
+}
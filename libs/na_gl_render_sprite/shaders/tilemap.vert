@@ -0,0 +1,30 @@
+#version 450 core
+
+layout (binding = 0) uniform Tilemap {
+  mat4 view;
+  mat4 projection;
+  vec2 origin;
+  vec2 tileSize;
+};
+
+layout (binding = 1) uniform usampler2D cells;
+
+vec2 vertices[4] = vec2[](
+  vec2(0.0, 0.0),
+  vec2(1.0, 0.0),
+  vec2(1.0, 1.0),
+  vec2(0.0, 1.0)
+);
+
+// Position in cells: the integer part selects the cell, the fraction the
+// texel inside its tile.
+layout (location = 0) out vec2 outCell;
+
+out gl_PerVertex {
+  vec4 gl_Position;
+};
+
+void main() {
+  outCell = vertices[gl_VertexID] * vec2(textureSize(cells, 0));
+  gl_Position = projection * view * vec4(origin + outCell * tileSize, 0.0, 1.0);
+}
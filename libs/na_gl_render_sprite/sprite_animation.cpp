@@ -0,0 +1,175 @@
+module;
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <glad/glad.h>
+#include <memory>
+#include <na_error/macros.hpp>
+#include <span>
+#include <vector>
+
+export module na_gl_render_sprite:sprite_animation;
+
+import na_error;
+import na_gl;
+import na_gl_render_common;
+import :texture_atlas;
+
+namespace na::gl {
+
+/* Index of a clip in SpriteClips. Compact sprites store it in their region
+ * field with SPRITE_CLIP_BIT set. */
+export using SpriteClipId = std::uint16_t;
+
+export constexpr std::uint16_t SPRITE_CLIP_BIT =
+    static_cast<std::uint16_t>(ATLAS_MAX_REGIONS);
+export constexpr std::size_t MAX_SPRITE_CLIPS = SPRITE_CLIP_BIT;
+
+static_assert(std::has_single_bit(ATLAS_MAX_REGIONS) &&
+              ATLAS_MAX_REGIONS <= 0x8000);
+
+export enum class SpriteLoop : std::uint32_t {
+  /* Stops on the last frame. */
+  Once,
+  Repeat,
+  /* Plays forwards then backwards without repeating the end frames. */
+  PingPong,
+};
+
+/* Matches "SpriteClip" in sprite_compact.vert; SSBO binding 4. Frames are
+ * firstFrame .. firstFrame + frameCount in the frame table at binding 5. */
+export using SpriteClip =
+    GpuStruct<"SpriteClip", GpuLayoutRule::Std430,
+              GpuField<"firstFrame", std::uint32_t>,
+              GpuField<"frameCount", std::uint32_t>,
+              GpuField<"frameRate", float>, GpuField<"loop", std::uint32_t>>;
+
+export struct SpriteClipConfig {
+  /* Atlas regions in playback order. */
+  std::span<const AtlasRegionId> frames;
+  /* Frames per second. */
+  float frameRate = 12.0f;
+  SpriteLoop loop = SpriteLoop::Repeat;
+};
+
+/* Flipbook clips evaluated by sprite_compact.vert: an animated compact sprite
+ * carries its clip and start time, and the vertex shader picks the frame
+ * from the Shared block's time, so sprites that only animate need no CPU
+ * writes after they are placed. Clips are append-only. */
+export class SpriteClips {
+  std::vector<SpriteClip> _clips;
+  std::vector<std::uint32_t> _frames;
+  GLuint _clipBuffer{};
+  GLuint _frameBuffer{};
+  std::size_t _clipCapacity = 0;
+  std::size_t _frameCapacity = 0;
+  bool _dirty = true;
+
+  SpriteClips() noexcept = default;
+
+  /* Grows buffer to hold at least size bytes; contents are rewritten by the
+   * caller. */
+  static VoidResult reserve(GLuint &buffer, std::size_t &capacity,
+                            std::size_t size) noexcept {
+    if (size <= capacity) {
+      return {};
+    }
+    auto grown = std::max<std::size_t>(capacity * 2, 256);
+    while (grown < size) {
+      grown *= 2;
+    }
+    AUTO_RESULT(created, GL::instance().createBuffer());
+    if (auto storage = GL::instance().namedBufferStorage(
+            created, static_cast<GLsizeiptr>(grown), nullptr,
+            GL_DYNAMIC_STORAGE_BIT);
+        storage.failed()) {
+      GL::instance().deleteBuffer(created);
+      return storage.errorWithPrefix("({}:{})", __FUNCTION__, __LINE__);
+    }
+    if (buffer != 0) {
+      GL::instance().deleteBuffer(buffer);
+    }
+    buffer = created;
+    capacity = grown;
+    return {};
+  }
+
+  VoidResult flush() noexcept {
+    if (!_dirty) {
+      return {};
+    }
+    auto clipBytes = _clips.size() * SpriteClip::SIZE;
+    auto frameBytes = _frames.size() * sizeof(std::uint32_t);
+    CHECK_RESULT(reserve(_clipBuffer, _clipCapacity, clipBytes));
+    CHECK_RESULT(reserve(_frameBuffer, _frameCapacity, frameBytes));
+    if (clipBytes != 0) {
+      CHECK_RESULT(GL::instance().namedBufferSubData(
+          _clipBuffer, 0, static_cast<GLsizeiptr>(clipBytes), _clips.data()));
+      CHECK_RESULT(GL::instance().namedBufferSubData(
+          _frameBuffer, 0, static_cast<GLsizeiptr>(frameBytes),
+          _frames.data()));
+    }
+    _dirty = false;
+    return {};
+  }
+
+public:
+  SpriteClips(const SpriteClips &) = delete;
+  SpriteClips &operator=(const SpriteClips &) = delete;
+
+  ~SpriteClips() noexcept {
+    if (_clipBuffer != 0) {
+      GL::instance().deleteBuffer(_clipBuffer);
+    }
+    if (_frameBuffer != 0) {
+      GL::instance().deleteBuffer(_frameBuffer);
+    }
+  }
+
+  static UniqueResult<SpriteClips> create() noexcept {
+    auto clips = std::unique_ptr<SpriteClips>(new SpriteClips());
+    CHECK_RESULT(clips->flush());
+    return clips;
+  }
+
+  std::size_t size() const noexcept { return _clips.size(); }
+
+  Result<SpriteClipId> add(const SpriteClipConfig &config) noexcept {
+    if (config.frames.empty() || config.frameRate <= 0.0f) {
+      return SimpleError("sprite clip needs frames and a positive frame rate, "
+                         "got {} frames at {}",
+                         config.frames.size(), config.frameRate);
+    }
+    if (_clips.size() >= MAX_SPRITE_CLIPS) {
+      return SimpleError("out of sprite clip ids");
+    }
+    for (auto frame : config.frames) {
+      if (frame >= ATLAS_MAX_REGIONS) {
+        return SimpleError("sprite clip frame {} is not an atlas region id",
+                           frame);
+      }
+    }
+    auto id = static_cast<SpriteClipId>(_clips.size());
+    _clips.emplace_back()
+        .set<"firstFrame">(static_cast<std::uint32_t>(_frames.size()))
+        .set<"frameCount">(static_cast<std::uint32_t>(config.frames.size()))
+        .set<"frameRate">(config.frameRate)
+        .set<"loop">(static_cast<std::uint32_t>(config.loop));
+    _frames.insert(_frames.end(), config.frames.begin(), config.frames.end());
+    _dirty = true;
+    return id;
+  }
+
+  /* Uploads new clips and binds both tables for sprite_compact.vert. */
+  VoidResult bind(GLuint clipBinding = 4, GLuint frameBinding = 5) noexcept {
+    CHECK_RESULT(flush());
+    CHECK_RESULT(GL::instance().bindBufferBase(GL_SHADER_STORAGE_BUFFER,
+                                               clipBinding, _clipBuffer));
+    return GL::instance().bindBufferBase(GL_SHADER_STORAGE_BUFFER,
+                                         frameBinding, _frameBuffer);
+  }
+};
+
+} // namespace na::gl
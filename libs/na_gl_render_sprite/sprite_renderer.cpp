@@ -0,0 +1,537 @@
+module;
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <format>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <memory>
+#include <na_error/macros.hpp>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+export module na_gl_render_sprite:sprite_renderer;
+
+import na_error;
+import na_gl;
+import na_gl_render_common;
+import na_gl_render_sprite_shaders;
+import :compact_sprite;
+import :static_sprite_batch;
+
+namespace na::gl {
+
+/* Matches "Instance" in sprite.vert; SSBO binding 0. */
+export using SpriteInstance =
+    GpuStruct<"Instance", GpuLayoutRule::Std430, GpuField<"local", glm::mat4>,
+              GpuField<"tint", glm::vec4>>;
+
+/* Sources of the built-in sprite program, for compiling it through a
+ * ShaderBatch or ProgramCache. */
+export std::array<ShaderSource, 2> spriteShaderSources() noexcept {
+  const auto &pack = na_gl_render_sprite_shaders::PACK;
+  return {{
+      {GL_VERTEX_SHADER, pack.find("sprite.vert")->source},
+      {GL_FRAGMENT_SHADER, pack.find("sprite.frag")->source},
+  }};
+}
+
+/* The compute shader for BasicSpriteRenderer::setCullProgram() with
+ * SpriteInstance. */
+export ShaderSource spriteCullShaderSource() noexcept {
+  const auto &pack = na_gl_render_sprite_shaders::PACK;
+  return {GL_COMPUTE_SHADER, pack.find("sprite_cull.comp")->source};
+}
+
+/* The same shaders in the source tree, for ShaderHotReloader. */
+export std::array<ShaderFile, 2> spriteShaderFiles() noexcept {
+  constexpr std::string_view dir = NA_GL_RENDER_SPRITE_SHADER_DIR;
+  return {{
+      {GL_VERTEX_SHADER, std::format("{}/sprite.vert", dir)},
+      {GL_FRAGMENT_SHADER, std::format("{}/sprite.frag", dir)},
+  }};
+}
+
+export struct SpriteMaterial {
+  const ShaderProgram *program;
+  /* Bound to texture unit 0 when non-zero. */
+  GLuint texture = 0;
+  /* With depth sorting, translucent sprites are blended back-to-front after
+   * every opaque one; opaque sprites must cover their pixels fully. */
+  bool translucent = false;
+
+  bool operator==(const SpriteMaterial &) const noexcept = default;
+};
+
+export struct SpriteRendererConfig {
+  /* Instances per frame the stream buffer starts with; it doubles after a
+   * frame that ran out of space. */
+  std::size_t initialCapacity = 65536;
+  /* Stream runs per frame, i.e. material or depth changes, whose alignment
+   * padding is reserved up front; it doubles after a frame that needed
+   * more. */
+  std::size_t initialRuns = 64;
+};
+
+export struct SpriteRendererStats {
+  std::size_t sprites{};
+  /* Instances drawn from static batches, which cost no per-frame upload. */
+  std::size_t staticSprites{};
+  std::size_t draws{};
+  /* Sprites that did not fit this frame. */
+  std::size_t dropped{};
+  std::size_t capacity{};
+};
+
+/* Draws instanced quads whose per-instance data is written straight into a
+ * persistently mapped SSBO. Consecutive submissions with the same material
+ * form one glDrawArraysInstanced(GL_TRIANGLE_FAN, 0, 4, N), so callers
+ * should submit grouped by material. Instance is the GpuStruct the
+ * material's vertex shader reads at SSBO binding 0. */
+export template <typename Instance> class BasicSpriteRenderer {
+  struct Draw {
+    SpriteMaterial material;
+    /* A static batch's buffer, or 0 for the stream. */
+    GLuint buffer;
+    GLintptr offset;
+    std::size_t count;
+    float depth;
+  };
+
+  /* DrawArraysIndirectCommand. */
+  struct IndirectCommand {
+    GLuint count;
+    GLuint instanceCount;
+    GLuint first;
+    GLuint baseInstance;
+  };
+
+  std::optional<StreamBuffer> _stream;
+  GLuint _vertexArray;
+  std::size_t _alignment;
+  std::size_t _capacity;
+  CameraShared _shared{};
+  StreamAllocation _sharedAllocation{};
+  const CameraBuffer *_cameras = nullptr;
+  CameraId _camera{};
+  std::vector<Draw> _draws;
+  SpriteRendererStats _stats{};
+  bool _grow = false;
+  std::size_t _runCapacity;
+  /* Stream runs started this frame, each padded to _alignment. */
+  std::size_t _runs = 0;
+  bool _growRuns = false;
+  const ShaderProgram *_cullProgram = nullptr;
+  bool _depthSorting = false;
+  /* GPU-only copy of a stream frame that culling compacts runs into. */
+  GLuint _culledBuffer{};
+  std::size_t _culledSize = 0;
+  GLuint _commandBuffer{};
+  std::size_t _commandSize = 0;
+  std::vector<std::byte> _commands;
+
+  BasicSpriteRenderer(SpriteRendererConfig config, GLuint vertexArray,
+                      std::size_t alignment) noexcept
+      : _vertexArray(vertexArray), _alignment(alignment),
+        _capacity(config.initialCapacity),
+        _runCapacity(std::max<std::size_t>(config.initialRuns, 1)) {}
+
+  /* Room for the instances plus the Shared block, the alignment padding in
+   * front of it and of every run, rounded so every frame region starts
+   * aligned. */
+  std::size_t frameSize(std::size_t capacity,
+                        std::size_t runs) const noexcept {
+    auto size = capacity * Instance::SIZE + CameraShared::SIZE +
+                (runs + 1) * _alignment;
+    return (size + _alignment - 1) & ~(_alignment - 1);
+  }
+
+  /* Commands are bound as SSBO ranges, so each gets an aligned slot. */
+  std::size_t commandStride() const noexcept {
+    return std::max(_alignment, sizeof(IndirectCommand));
+  }
+
+  static Result<GLuint> createStorage(std::size_t size,
+                                      GLbitfield flags) noexcept {
+    AUTO_RESULT(buffer, GL::instance().createBuffer());
+    if (auto storage = GL::instance().namedBufferStorage(
+            buffer, static_cast<GLsizeiptr>(size), nullptr, flags);
+        storage.failed()) {
+      GL::instance().deleteBuffer(buffer);
+      return storage.errorWithPrefix("({}:{})", __FUNCTION__, __LINE__);
+    }
+    return buffer;
+  }
+
+  VoidResult reserveCullBuffers(std::size_t commandBytes) noexcept {
+    if (_culledSize < _stream->frameSize()) {
+      AUTO_RESULT(buffer, createStorage(_stream->frameSize(), 0));
+      if (_culledBuffer != 0) {
+        GL::instance().deleteBuffer(_culledBuffer);
+      }
+      _culledBuffer = buffer;
+      _culledSize = _stream->frameSize();
+    }
+    if (_commandSize < commandBytes) {
+      auto size = std::max(commandBytes, 2 * _commandSize);
+      AUTO_RESULT(buffer, createStorage(size, GL_DYNAMIC_STORAGE_BIT));
+      if (_commandBuffer != 0) {
+        GL::instance().deleteBuffer(_commandBuffer);
+      }
+      _commandBuffer = buffer;
+      _commandSize = size;
+    }
+    return {};
+  }
+
+  /* Where a run lands in _culledBuffer: the same place it has in its stream
+   * frame, which is aligned and never overlaps another run. */
+  GLintptr culledOffset(const Draw &draw) const noexcept {
+    return draw.offset % static_cast<GLintptr>(_stream->frameSize());
+  }
+
+  /* Opaque runs nearest first, then translucent runs farthest first. The
+   * sort is stable, so runs at one depth keep their submission order. */
+  void sortByDepth() noexcept {
+    std::ranges::stable_sort(_draws, [](const Draw &a, const Draw &b) {
+      if (a.material.translucent != b.material.translucent) {
+        return b.material.translucent;
+      }
+      return a.material.translucent ? a.depth < b.depth : a.depth > b.depth;
+    });
+  }
+
+  /* Compact instances have no z, so sprite_compact.vert places a whole run
+   * at its depth through the runDepth uniform. Programs without it are left
+   * alone. */
+  static VoidResult setRunDepth(const ShaderProgram &program,
+                                float depth) noexcept {
+    const auto *uniform =
+        program.reflection().uniform(hashString("runDepth"));
+    if (uniform == nullptr) {
+      return {};
+    }
+    return GL::instance().programUniform(program.id(), uniform->location,
+                                         GL_FLOAT, 1, &depth);
+  }
+
+  /* Compacts the visible instances of every run into _culledBuffer and
+   * counts them into the run's indirect command. */
+  VoidResult cull() noexcept {
+    auto stride = commandStride();
+    CHECK_RESULT(reserveCullBuffers(_draws.size() * stride));
+    _commands.assign(_draws.size() * stride, std::byte{});
+    for (std::size_t i = 0; i < _draws.size(); ++i) {
+      IndirectCommand command{
+          .count = 4, .instanceCount = 0, .first = 0, .baseInstance = 0};
+      std::memcpy(_commands.data() + i * stride, &command, sizeof(command));
+    }
+    CHECK_RESULT(GL::instance().namedBufferSubData(
+        _commandBuffer, 0, static_cast<GLsizeiptr>(_commands.size()),
+        _commands.data()));
+
+    constexpr GLuint GROUP_SIZE = 64;
+    CHECK_RESULT(GL::instance().useProgram(_cullProgram->id()));
+    for (std::size_t i = 0; i < _draws.size(); ++i) {
+      const auto &draw = _draws[i];
+      if (draw.buffer != 0) {
+        continue;
+      }
+      auto bytes = static_cast<GLsizeiptr>(draw.count * Instance::SIZE);
+      CHECK_RESULT(GL::instance().bindBufferRange(
+          GL_SHADER_STORAGE_BUFFER, 0, _stream->id(), draw.offset, bytes));
+      CHECK_RESULT(GL::instance().bindBufferRange(
+          GL_SHADER_STORAGE_BUFFER, 2, _culledBuffer, culledOffset(draw),
+          bytes));
+      CHECK_RESULT(GL::instance().bindBufferRange(
+          GL_SHADER_STORAGE_BUFFER, 3, _commandBuffer,
+          static_cast<GLintptr>(i * stride), sizeof(IndirectCommand)));
+      auto groups = (static_cast<GLuint>(draw.count) + GROUP_SIZE - 1) /
+                    GROUP_SIZE;
+      CHECK_RESULT(GL::instance().dispatchCompute(groups, 1, 1));
+    }
+    return GL::instance().memoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT |
+                                        GL_COMMAND_BARRIER_BIT);
+  }
+
+public:
+  BasicSpriteRenderer(const BasicSpriteRenderer &) = delete;
+  BasicSpriteRenderer &operator=(const BasicSpriteRenderer &) = delete;
+
+  ~BasicSpriteRenderer() noexcept {
+    if (_culledBuffer != 0) {
+      GL::instance().deleteBuffer(_culledBuffer);
+    }
+    if (_commandBuffer != 0) {
+      GL::instance().deleteBuffer(_commandBuffer);
+    }
+    if (_vertexArray != 0) {
+      GL::instance().deleteVertexArray(_vertexArray);
+    }
+  }
+
+  static UniqueResult<BasicSpriteRenderer>
+  create(SpriteRendererConfig config = {}) noexcept {
+    AUTO_RESULT(storageAlignment, GL::instance().getInteger(
+                                      GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT));
+    AUTO_RESULT(uniformAlignment, GL::instance().getInteger(
+                                      GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT));
+    auto alignment = std::max<std::size_t>(
+        {static_cast<std::size_t>(storageAlignment),
+         static_cast<std::size_t>(uniformAlignment), Instance::ALIGNMENT});
+    // Core profile needs a vertex array bound even though quads are
+    // generated from gl_VertexID.
+    AUTO_RESULT(vertexArray, GL::instance().createVertexArray());
+    auto renderer = std::unique_ptr<BasicSpriteRenderer>(
+        new BasicSpriteRenderer(config, vertexArray, alignment));
+    UNIQUE_RESULT(stream, StreamBuffer::create(renderer->frameSize(
+                              renderer->_capacity, renderer->_runCapacity)));
+    renderer->_stream.emplace(std::move(stream));
+    return renderer;
+  }
+
+  const SpriteRendererStats &stats() const noexcept { return _stats; }
+
+  /* Culls every run against the camera on the GPU with a program built from
+   * spriteCullShaderSource() or compactSpriteCullShaderSource(), matching
+   * Instance, and draws the survivors with glDrawArraysIndirect; the CPU
+   * never learns how many were visible. Culling reorders instances within a
+   * run. nullptr draws everything. */
+  void setCullProgram(const ShaderProgram *program) noexcept {
+    _cullProgram = program;
+  }
+
+  /* Splits runs by SpriteMaterial::translucent: opaque runs are drawn
+   * front-to-back with depth writes so early-Z rejects what they hide, then
+   * translucent runs back-to-front with blending and without depth writes.
+   * Runs are ordered by the depth passed to allocate() and draw(), larger
+   * being nearer as with glm::ortho; instances within a run keep their
+   * order. end() leaves blending and the depth test disabled. The frame
+   * must clear the depth buffer. */
+  void setDepthSorting(bool enabled) noexcept { _depthSorting = enabled; }
+
+  void setCamera(const glm::mat4 &view, const glm::mat4 &projection) noexcept {
+    _shared.set<"view">(view).set<"projection">(projection);
+    _cameras = nullptr;
+  }
+
+  /* Draws through a camera of a shared CameraBuffer instead of the
+   * renderer's own Shared block; end() binds its slot, so the buffer's
+   * beginFrame() must precede it. Time then comes from the CameraBuffer.
+   * Switch between the two setCamera() overloads before begin(). */
+  void setCamera(const CameraBuffer &cameras, CameraId camera) noexcept {
+    _cameras = &cameras;
+    _camera = camera;
+  }
+
+  /* Seconds on the clock animated sprites' start times refer to. Keep it
+   * small, e.g. since the level started, as it is a float. */
+  void setTime(float seconds) noexcept { _shared.set<"time">(seconds); }
+
+  /* Waits until the frame's stream region is free again. */
+  VoidResult begin() noexcept {
+    if (_grow || _growRuns) {
+      if (_grow) {
+        _capacity *= 2;
+      }
+      if (_growRuns) {
+        _runCapacity *= 2;
+      }
+      _grow = false;
+      _growRuns = false;
+      _stream.reset();
+      UNIQUE_RESULT(stream,
+                    StreamBuffer::create(frameSize(_capacity, _runCapacity)));
+      _stream.emplace(std::move(stream));
+    }
+    _draws.clear();
+    _runs = 0;
+    _stats = {.sprites = 0,
+              .staticSprites = 0,
+              .draws = 0,
+              .dropped = 0,
+              .capacity = _capacity};
+    CHECK_RESULT(_stream->beginFrame());
+    // Reserved up front so instances can never crowd the camera block out;
+    // a CameraBuffer carries it instead when one is attached.
+    _sharedAllocation = {};
+    if (_cameras == nullptr) {
+      _sharedAllocation = *_stream->allocate(CameraShared::SIZE, _alignment);
+    }
+    return {};
+  }
+
+  /* Reserves count contiguous instances for the material in mapped GPU
+   * memory. The span may be shorter than requested when the frame's capacity
+   * is exhausted; the shortfall is counted in stats().dropped and capacity
+   * grows for the next frame. Instances must be fully written before end().
+   * The span is plain memory, so worker threads may fill disjoint slices of
+   * it (see ThreadPool::parallelFor) as long as they finish before end();
+   * allocate() itself belongs to the GL thread. depth orders the run under
+   * setDepthSorting() and should match the instances' z; compact instances
+   * are drawn at it. */
+  std::span<Instance> allocate(const SpriteMaterial &material,
+                               std::size_t count,
+                               float depth = 0.0f) noexcept {
+    auto fits = std::min(count, _capacity - _stats.sprites);
+    if (fits < count) {
+      _stats.dropped += count - fits;
+      _grow = true;
+    }
+    if (fits == 0) {
+      return {};
+    }
+    auto size = fits * Instance::SIZE;
+    auto extendsLast = !_draws.empty() && _draws.back().buffer == 0 &&
+                       _draws.back().material == material &&
+                       _draws.back().depth == depth;
+    if (!extendsLast && ++_runs > _runCapacity) {
+      // The padding may still fit this frame; reserve it from the next.
+      _growRuns = true;
+    }
+    auto allocation = _stream->allocate(
+        size, extendsLast ? Instance::ALIGNMENT : _alignment);
+    if (!allocation) {
+      // Instance room was checked above, so the run padding ran out.
+      _stats.dropped += fits;
+      _growRuns = true;
+      return {};
+    }
+    if (extendsLast && allocation->offset ==
+                           _draws.back().offset +
+                               static_cast<GLintptr>(_draws.back().count *
+                                                     Instance::SIZE)) {
+      _draws.back().count += fits;
+    } else {
+      _draws.push_back({.material = material,
+                        .buffer = 0,
+                        .offset = allocation->offset,
+                        .count = fits,
+                        .depth = depth});
+    }
+    _stats.sprites += fits;
+    return {reinterpret_cast<Instance *>(allocation->data), fits};
+  }
+
+  void submit(const SpriteMaterial &material, const Instance &instance,
+              float depth = 0.0f) noexcept {
+    if (auto slot = allocate(material, 1, depth); !slot.empty()) {
+      slot[0] = instance;
+    }
+  }
+
+  /* Draws a retained batch in submission order among the frame's sprites,
+   * uploading its pending edits first. Static batches are never culled. */
+  VoidResult draw(const SpriteMaterial &material,
+                  BasicStaticSpriteBatch<Instance> &batch,
+                  float depth = 0.0f) noexcept {
+    CHECK_RESULT(batch.flush());
+    if (batch.size() != 0) {
+      _draws.push_back({.material = material,
+                        .buffer = batch.id(),
+                        .offset = 0,
+                        .count = batch.size(),
+                        .depth = depth});
+      _stats.staticSprites += batch.size();
+    }
+    return {};
+  }
+
+  /* Issues one instanced draw per material run and fences the stream. */
+  VoidResult end() noexcept {
+    if (_depthSorting) {
+      sortByDepth();
+      CHECK_RESULT(GL::instance().enable(GL_DEPTH_TEST));
+      // Equal depths keep submission order.
+      CHECK_RESULT(GL::instance().depthFunc(GL_LEQUAL));
+    }
+    if (_cameras != nullptr) {
+      CHECK_RESULT(_cameras->bind(_camera));
+    } else {
+      if (_sharedAllocation.data == nullptr) {
+        return SimpleError("sprite renderer lost its camera after begin()");
+      }
+      *reinterpret_cast<CameraShared *>(_sharedAllocation.data) = _shared;
+      CHECK_RESULT(GL::instance().bindBufferRange(
+          GL_UNIFORM_BUFFER, 0, _stream->id(), _sharedAllocation.offset,
+          _sharedAllocation.size));
+    }
+    auto culling = _cullProgram != nullptr && !_draws.empty();
+    if (culling) {
+      CHECK_RESULT(cull());
+      CHECK_RESULT(
+          GL::instance().bindBuffer(GL_DRAW_INDIRECT_BUFFER, _commandBuffer));
+    }
+    CHECK_RESULT(GL::instance().bindVertexArray(_vertexArray));
+
+    const ShaderProgram *boundProgram = nullptr;
+    GLuint boundTexture = 0;
+    auto blending = false;
+    for (std::size_t i = 0; i < _draws.size(); ++i) {
+      const auto &draw = _draws[i];
+      if (_depthSorting && draw.material.translucent && !blending) {
+        blending = true;
+        CHECK_RESULT(GL::instance().depthMask(GL_FALSE));
+        CHECK_RESULT(GL::instance().enable(GL_BLEND));
+        CHECK_RESULT(
+            GL::instance().blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA));
+      }
+      if (draw.material.program != boundProgram) {
+        boundProgram = draw.material.program;
+        CHECK_RESULT(GL::instance().useProgram(boundProgram->id()));
+      }
+      if constexpr (std::is_same_v<Instance, CompactSpriteInstance>) {
+        CHECK_RESULT(setRunDepth(*draw.material.program, draw.depth));
+      }
+      if (draw.material.texture != 0 &&
+          draw.material.texture != boundTexture) {
+        boundTexture = draw.material.texture;
+        CHECK_RESULT(GL::instance().bindTextureUnit(0, boundTexture));
+      }
+      auto bytes = static_cast<GLsizeiptr>(draw.count * Instance::SIZE);
+      if (draw.buffer != 0) {
+        CHECK_RESULT(GL::instance().bindBufferRange(
+            GL_SHADER_STORAGE_BUFFER, 0, draw.buffer, draw.offset, bytes));
+        CHECK_RESULT(GL::instance().drawArraysInstanced(
+            GL_TRIANGLE_FAN, 0, 4, static_cast<GLsizei>(draw.count)));
+        continue;
+      }
+      if (culling) {
+        CHECK_RESULT(GL::instance().bindBufferRange(
+            GL_SHADER_STORAGE_BUFFER, 0, _culledBuffer, culledOffset(draw),
+            bytes));
+        CHECK_RESULT(GL::instance().drawArraysIndirect(
+            GL_TRIANGLE_FAN, static_cast<GLintptr>(i * commandStride())));
+        continue;
+      }
+      CHECK_RESULT(GL::instance().bindBufferRange(
+          GL_SHADER_STORAGE_BUFFER, 0, _stream->id(), draw.offset, bytes));
+      CHECK_RESULT(GL::instance().drawArraysInstanced(
+          GL_TRIANGLE_FAN, 0, 4, static_cast<GLsizei>(draw.count)));
+    }
+    _stats.draws = _draws.size();
+    if (blending) {
+      CHECK_RESULT(GL::instance().depthMask(GL_TRUE));
+      CHECK_RESULT(GL::instance().disable(GL_BLEND));
+    }
+    if (_depthSorting) {
+      CHECK_RESULT(GL::instance().disable(GL_DEPTH_TEST));
+    }
+    return _stream->endFrame();
+  }
+};
+
+export using StaticSpriteBatch = BasicStaticSpriteBatch<SpriteInstance>;
+export using CompactStaticSpriteBatch =
+    BasicStaticSpriteBatch<CompactSpriteInstance>;
+
+export using SpriteRenderer = BasicSpriteRenderer<SpriteInstance>;
+export using CompactSpriteRenderer =
+    BasicSpriteRenderer<CompactSpriteInstance>;
+
+} // namespace na::gl
@@ -0,0 +1,164 @@
+module;
+
+#include <algorithm>
+#include <cstddef>
+#include <glad/glad.h>
+#include <memory>
+#include <na_error/macros.hpp>
+#include <span>
+#include <vector>
+
+export module na_gl_render_sprite:static_sprite_batch;
+
+import na_error;
+import na_gl;
+
+namespace na::gl {
+
+/* Sprites that live across frames in their own SSBO, for scenery that rarely
+ * changes. Edits go to a CPU shadow copy and record the instance range they
+ * touched; flush() merges nearby ranges and uploads each merged range with
+ * one glNamedBufferSubData, so upload bytes follow what changed rather than
+ * the batch size. */
+export template <typename Instance> class BasicStaticSpriteBatch {
+public:
+  /* Dirty ranges at most this many clean instances apart are uploaded as
+   * one, trading a few redundant bytes for fewer calls. */
+  static constexpr std::size_t MERGE_GAP = 16;
+
+private:
+  struct Range {
+    std::size_t first;
+    std::size_t end;
+  };
+
+  GLuint _buffer{};
+  std::size_t _capacity = 0;
+  std::vector<Instance> _instances;
+  std::vector<Range> _dirty;
+
+  BasicStaticSpriteBatch() noexcept = default;
+
+  void markDirty(std::size_t first, std::size_t count) noexcept {
+    if (count != 0) {
+      _dirty.push_back({.first = first, .end = first + count});
+    }
+  }
+
+  /* Replaces the buffer with an empty one of capacity instances and marks
+   * every instance for upload. */
+  VoidResult reallocate(std::size_t capacity) noexcept {
+    AUTO_RESULT(buffer, GL::instance().createBuffer());
+    if (auto storage = GL::instance().namedBufferStorage(
+            buffer, static_cast<GLsizeiptr>(capacity * Instance::SIZE),
+            nullptr, GL_DYNAMIC_STORAGE_BIT);
+        storage.failed()) {
+      GL::instance().deleteBuffer(buffer);
+      return storage.errorWithPrefix("({}:{})", __FUNCTION__, __LINE__);
+    }
+    if (_buffer != 0) {
+      GL::instance().deleteBuffer(_buffer);
+    }
+    _buffer = buffer;
+    _capacity = capacity;
+    _dirty.clear();
+    markDirty(0, _instances.size());
+    return {};
+  }
+
+public:
+  BasicStaticSpriteBatch(const BasicStaticSpriteBatch &) = delete;
+  BasicStaticSpriteBatch &operator=(const BasicStaticSpriteBatch &) = delete;
+
+  ~BasicStaticSpriteBatch() noexcept {
+    if (_buffer != 0) {
+      GL::instance().deleteBuffer(_buffer);
+    }
+  }
+
+  static UniqueResult<BasicStaticSpriteBatch>
+  create(std::size_t capacity = 0) noexcept {
+    auto batch =
+        std::unique_ptr<BasicStaticSpriteBatch>(new BasicStaticSpriteBatch());
+    batch->_instances.reserve(capacity);
+    CHECK_RESULT(batch->reallocate(std::max<std::size_t>(capacity, 64)));
+    return batch;
+  }
+
+  GLuint id() const noexcept { return _buffer; }
+
+  std::size_t size() const noexcept { return _instances.size(); }
+
+  std::span<const Instance> instances() const noexcept { return _instances; }
+
+  /* Adds count instances at the end. The span stays valid until the next
+   * append(). */
+  std::span<Instance> append(std::size_t count) noexcept {
+    auto first = _instances.size();
+    _instances.resize(first + count);
+    markDirty(first, count);
+    return std::span(_instances).subspan(first, count);
+  }
+
+  /* Instances [first, first + count) for rewriting; out-of-range parts are
+   * cut off. */
+  std::span<Instance> edit(std::size_t first, std::size_t count) noexcept {
+    first = std::min(first, _instances.size());
+    count = std::min(count, _instances.size() - first);
+    markDirty(first, count);
+    return std::span(_instances).subspan(first, count);
+  }
+
+  void set(std::size_t index, const Instance &instance) noexcept {
+    if (auto slot = edit(index, 1); !slot.empty()) {
+      slot[0] = instance;
+    }
+  }
+
+  /* Drops the instances from size on; nothing needs uploading. */
+  void truncate(std::size_t size) noexcept {
+    if (size < _instances.size()) {
+      _instances.resize(size);
+    }
+  }
+
+  bool dirty() const noexcept { return !_dirty.empty(); }
+
+  VoidResult flush() noexcept {
+    if (_instances.size() > _capacity) {
+      auto capacity = _capacity * 2;
+      while (capacity < _instances.size()) {
+        capacity *= 2;
+      }
+      CHECK_RESULT(reallocate(capacity));
+    }
+    if (_dirty.empty()) {
+      return {};
+    }
+    std::ranges::sort(_dirty, {}, &Range::first);
+    auto merged = _dirty.front();
+    auto upload = [&](Range range) noexcept -> VoidResult {
+      range.end = std::min(range.end, _instances.size());
+      if (range.first >= range.end) {
+        return {};
+      }
+      return GL::instance().namedBufferSubData(
+          _buffer, static_cast<GLintptr>(range.first * Instance::SIZE),
+          static_cast<GLsizeiptr>((range.end - range.first) * Instance::SIZE),
+          _instances.data() + range.first);
+    };
+    for (const auto &range : std::span(_dirty).subspan(1)) {
+      if (range.first <= merged.end + MERGE_GAP) {
+        merged.end = std::max(merged.end, range.end);
+        continue;
+      }
+      CHECK_RESULT(upload(merged));
+      merged = range;
+    }
+    CHECK_RESULT(upload(merged));
+    _dirty.clear();
+    return {};
+  }
+};
+
+} // namespace na::gl
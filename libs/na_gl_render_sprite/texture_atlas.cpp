@@ -0,0 +1,484 @@
+module;
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <limits>
+#include <memory>
+#include <na_error/macros.hpp>
+#include <optional>
+#include <span>
+#include <vector>
+
+export module na_gl_render_sprite:texture_atlas;
+
+import na_error;
+import na_gl;
+import na_gl_render_common;
+
+namespace na::gl {
+
+export struct AtlasRect {
+  GLint x;
+  GLint y;
+  GLsizei width;
+  GLsizei height;
+};
+
+/* Bottom-left skyline packer: the top edge of the packed rectangles is kept
+ * as a list of horizontal segments and each insertion goes where it ends
+ * lowest. Space is only reclaimed by clear(). */
+export class SkylinePacker {
+  struct Segment {
+    GLint x;
+    GLint y;
+    GLsizei width;
+  };
+
+  GLsizei _width;
+  GLsizei _height;
+  std::vector<Segment> _skyline;
+
+  /* The y a rectangle of width placed at segment index would rest on, or
+   * nullopt when it sticks out of the page. */
+  std::optional<GLint> fit(std::size_t index, GLsizei width,
+                           GLsizei height) const noexcept {
+    auto x = _skyline[index].x;
+    if (x + width > _width) {
+      return std::nullopt;
+    }
+    GLint y = 0;
+    GLsizei remaining = width;
+    for (auto i = index; remaining > 0; ++i) {
+      y = std::max(y, _skyline[i].y);
+      if (y + height > _height) {
+        return std::nullopt;
+      }
+      remaining -= _skyline[i].width;
+    }
+    return y;
+  }
+
+public:
+  SkylinePacker(GLsizei width, GLsizei height) noexcept
+      : _width(width), _height(height) {
+    clear();
+  }
+
+  void clear() noexcept {
+    _skyline.assign(1, {.x = 0, .y = 0, .width = _width});
+  }
+
+  std::optional<AtlasRect> insert(GLsizei width, GLsizei height) noexcept {
+    if (width <= 0 || height <= 0) {
+      return std::nullopt;
+    }
+    auto best = _skyline.size();
+    GLint bestY = 0;
+    GLint bestTop = std::numeric_limits<GLint>::max();
+    for (std::size_t i = 0; i < _skyline.size(); ++i) {
+      auto y = fit(i, width, height);
+      if (y && *y + height < bestTop) {
+        best = i;
+        bestY = *y;
+        bestTop = *y + height;
+      }
+    }
+    if (best == _skyline.size()) {
+      return std::nullopt;
+    }
+
+    AtlasRect rect{
+        .x = _skyline[best].x, .y = bestY, .width = width, .height = height};
+    _skyline.insert(_skyline.begin() + static_cast<std::ptrdiff_t>(best),
+                    {.x = rect.x, .y = bestTop, .width = width});
+    // Trim the segments now covered by the new one.
+    auto right = rect.x + width;
+    auto next = best + 1;
+    while (next < _skyline.size() && _skyline[next].x < right) {
+      auto &segment = _skyline[next];
+      auto overlap = std::min<GLsizei>(right - segment.x, segment.width);
+      segment.x += overlap;
+      segment.width -= overlap;
+      if (segment.width > 0) {
+        break;
+      }
+      _skyline.erase(_skyline.begin() + static_cast<std::ptrdiff_t>(next));
+    }
+    // Merge neighbours at the same height.
+    for (std::size_t i = 0; i + 1 < _skyline.size();) {
+      if (_skyline[i].y == _skyline[i + 1].y) {
+        _skyline[i].width += _skyline[i + 1].width;
+        _skyline.erase(_skyline.begin() + static_cast<std::ptrdiff_t>(i + 1));
+      } else {
+        ++i;
+      }
+    }
+    return rect;
+  }
+};
+
+/* Index of a region in TextureAtlas; it stays valid until remove(), across
+ * growth and defragmentation. */
+export using AtlasRegionId = std::uint16_t;
+
+/* Region ids fit in the low 15 bits of a compact sprite's region field;
+ * SPRITE_CLIP_BIT, the bit above them, marks flipbook clips instead. */
+export constexpr std::size_t ATLAS_MAX_REGIONS = 0x8000;
+
+/* The region every atlas starts with: one opaque white texel, for sprites
+ * that only use their tint. */
+export constexpr AtlasRegionId ATLAS_WHITE_REGION = 0;
+
+/* Matches "AtlasRegion" in sprite_compact.vert; SSBO binding 1. uv holds the
+ * minimum and maximum texture coordinates of the unpadded image. */
+export using AtlasRegion =
+    GpuStruct<"AtlasRegion", GpuLayoutRule::Std430, GpuField<"uv", glm::vec4>,
+              GpuField<"layer", std::uint32_t>>;
+
+export struct TextureAtlasConfig {
+  /* Width and height of every layer. */
+  GLsizei size = 2048;
+  GLsizei initialLayers = 1;
+  GLsizei maxLayers = 8;
+  /* Texels of edge extrusion around each image, so linear filtering never
+   * reads a neighbour. */
+  GLsizei padding = 2;
+  /* update() repacks once fewer than this fraction of the packed texels
+   * still belong to live regions, checked every defragmentInterval calls;
+   * an interval of 0 never defragments automatically. */
+  float defragmentBelow = 0.5f;
+  std::uint64_t defragmentInterval = 300;
+};
+
+export struct TextureAtlasStats {
+  std::size_t regions{};
+  GLsizei layers{};
+  /* Texels of live regions over texels handed out by the packers, padding
+   * included. */
+  float occupancy{};
+  std::size_t defragmentations{};
+};
+
+/* RGBA8 images packed into the layers of a GL_TEXTURE_2D_ARRAY. Regions are
+ * looked up by shaders through an SSBO of AtlasRegion indexed by
+ * AtlasRegionId, so sprites only carry the 16-bit id. The texture object
+ * changes when the atlas grows or is defragmented: read texture() again
+ * when building materials rather than caching the id. */
+export class TextureAtlas {
+  struct Region {
+    /* Padded rectangle; the image sits padding texels inside it. */
+    AtlasRect rect;
+    GLint layer;
+    bool live;
+  };
+
+  TextureAtlasConfig _config;
+  std::optional<Texture> _texture;
+  std::vector<SkylinePacker> _packers;
+  std::vector<Region> _regions;
+  std::vector<AtlasRegionId> _freeIds;
+  GLuint _regionBuffer{};
+  std::size_t _regionCapacity = 0;
+  bool _regionsDirty = true;
+  std::vector<std::byte> _scratch;
+  std::size_t _liveArea = 0;
+  std::size_t _packedArea = 0;
+  std::uint64_t _updates = 0;
+  std::size_t _defragmentations = 0;
+
+  explicit TextureAtlas(TextureAtlasConfig config) noexcept
+      : _config(config) {}
+
+  static std::size_t area(const AtlasRect &rect) noexcept {
+    return static_cast<std::size_t>(rect.width) *
+           static_cast<std::size_t>(rect.height);
+  }
+
+  /* Copies the first copyLayers layers of the current texture into a new one
+   * with the given layer count and makes it current. */
+  VoidResult reallocate(GLsizei layers, GLsizei copyLayers) noexcept {
+    UNIQUE_RESULT(texture, Texture::create2DArray(GL_RGBA8, _config.size,
+                                                  _config.size, layers));
+    if (_texture && copyLayers > 0) {
+      CHECK_RESULT(GL::instance().copyImageSubData(
+          _texture->id(), GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0, texture.id(),
+          GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0, _config.size, _config.size,
+          copyLayers));
+    }
+    _texture.reset();
+    _texture.emplace(std::move(texture));
+    return {};
+  }
+
+  /* Places a padded rectangle, growing the array when every layer is full. */
+  Result<Region> place(GLsizei width, GLsizei height) noexcept {
+    for (std::size_t layer = 0; layer < _packers.size(); ++layer) {
+      if (auto rect = _packers[layer].insert(width, height)) {
+        return Region{
+            .rect = *rect, .layer = static_cast<GLint>(layer), .live = true};
+      }
+    }
+    auto layers = _texture->layers();
+    if (layers >= _config.maxLayers) {
+      return SimpleError("texture atlas is full ({} layers)", layers);
+    }
+    CHECK_RESULT(reallocate(std::min(layers * 2, _config.maxLayers), layers));
+    while (_packers.size() < static_cast<std::size_t>(_texture->layers())) {
+      _packers.emplace_back(_config.size, _config.size);
+    }
+    auto rect =
+        _packers[static_cast<std::size_t>(layers)].insert(width, height);
+    return Region{.rect = *rect, .layer = layers, .live = true};
+  }
+
+  /* Uploads the image with its border texels repeated padding times. */
+  VoidResult upload(const Region &region, GLsizei width, GLsizei height,
+                    std::span<const std::byte> pixels) noexcept {
+    constexpr std::size_t TEXEL = 4;
+    auto padding = _config.padding;
+    auto paddedWidth = static_cast<std::size_t>(region.rect.width);
+    auto paddedHeight = static_cast<std::size_t>(region.rect.height);
+    _scratch.resize(paddedWidth * paddedHeight * TEXEL);
+    for (std::size_t y = 0; y < paddedHeight; ++y) {
+      auto sourceY = std::clamp<GLint>(static_cast<GLint>(y) - padding, 0,
+                                       height - 1);
+      for (std::size_t x = 0; x < paddedWidth; ++x) {
+        auto sourceX = std::clamp<GLint>(static_cast<GLint>(x) - padding, 0,
+                                         width - 1);
+        auto source = (static_cast<std::size_t>(sourceY) *
+                           static_cast<std::size_t>(width) +
+                       static_cast<std::size_t>(sourceX)) *
+                      TEXEL;
+        std::copy_n(pixels.data() + source, TEXEL,
+                    _scratch.data() + (y * paddedWidth + x) * TEXEL);
+      }
+    }
+    return GL::instance().textureSubImage3D(
+        _texture->id(), 0, region.rect.x, region.rect.y, region.layer,
+        region.rect.width, region.rect.height, 1, GL_RGBA, GL_UNSIGNED_BYTE,
+        _scratch.data(), _scratch.size());
+  }
+
+  /* Writes the region table to the SSBO, reallocating it when it grew. */
+  VoidResult flushRegions() noexcept {
+    if (!_regionsDirty) {
+      return {};
+    }
+    if (_regions.size() > _regionCapacity) {
+      auto capacity = std::max<std::size_t>(_regionCapacity * 2, 256);
+      while (capacity < _regions.size()) {
+        capacity *= 2;
+      }
+      AUTO_RESULT(buffer, GL::instance().createBuffer());
+      auto bytes = static_cast<GLsizeiptr>(capacity * AtlasRegion::SIZE);
+      if (auto storage = GL::instance().namedBufferStorage(
+              buffer, bytes, nullptr, GL_DYNAMIC_STORAGE_BIT);
+          storage.failed()) {
+        GL::instance().deleteBuffer(buffer);
+        return storage.errorWithPrefix("({}:{})", __FUNCTION__, __LINE__);
+      }
+      if (_regionBuffer != 0) {
+        GL::instance().deleteBuffer(_regionBuffer);
+      }
+      _regionBuffer = buffer;
+      _regionCapacity = capacity;
+    }
+    std::vector<AtlasRegion> table(_regions.size());
+    auto scale = 1.0f / static_cast<float>(_config.size);
+    auto padding = static_cast<float>(_config.padding);
+    for (std::size_t i = 0; i < _regions.size(); ++i) {
+      const auto &rect = _regions[i].rect;
+      glm::vec4 uv(static_cast<float>(rect.x) + padding,
+                   static_cast<float>(rect.y) + padding,
+                   static_cast<float>(rect.x + rect.width) - padding,
+                   static_cast<float>(rect.y + rect.height) - padding);
+      table[i]
+          .set<"uv">(uv * scale)
+          .set<"layer">(static_cast<std::uint32_t>(_regions[i].layer));
+    }
+    CHECK_RESULT(GL::instance().namedBufferSubData(
+        _regionBuffer, 0,
+        static_cast<GLsizeiptr>(table.size() * AtlasRegion::SIZE),
+        table.data()));
+    _regionsDirty = false;
+    return {};
+  }
+
+public:
+  TextureAtlas(const TextureAtlas &) = delete;
+  TextureAtlas &operator=(const TextureAtlas &) = delete;
+
+  ~TextureAtlas() noexcept {
+    if (_regionBuffer != 0) {
+      GL::instance().deleteBuffer(_regionBuffer);
+    }
+  }
+
+  static UniqueResult<TextureAtlas>
+  create(TextureAtlasConfig config = {}) noexcept {
+    if (config.size <= 2 * config.padding || config.initialLayers <= 0 ||
+        config.maxLayers < config.initialLayers) {
+      return SimpleError("invalid texture atlas config: size {}, padding {}, "
+                         "layers {}..{}",
+                         config.size, config.padding, config.initialLayers,
+                         config.maxLayers);
+    }
+    auto atlas = std::unique_ptr<TextureAtlas>(new TextureAtlas(config));
+    CHECK_RESULT(atlas->reallocate(config.initialLayers, 0));
+    for (GLsizei layer = 0; layer < config.initialLayers; ++layer) {
+      atlas->_packers.emplace_back(config.size, config.size);
+    }
+    constexpr std::byte WHITE[] = {std::byte{255}, std::byte{255},
+                                   std::byte{255}, std::byte{255}};
+    CHECK_RESULT(atlas->insert(1, 1, WHITE));
+    CHECK_RESULT(atlas->flushRegions());
+    return atlas;
+  }
+
+  const Texture &texture() const noexcept { return *_texture; }
+
+  TextureAtlasStats stats() const noexcept {
+    return {
+        .regions = _regions.size() - _freeIds.size(),
+        .layers = _texture->layers(),
+        .occupancy = _packedArea == 0 ? 0.0f
+                                      : static_cast<float>(_liveArea) /
+                                            static_cast<float>(_packedArea),
+        .defragmentations = _defragmentations,
+    };
+  }
+
+  /* Packs and uploads a tightly packed RGBA8 image. */
+  Result<AtlasRegionId> insert(GLsizei width, GLsizei height,
+                               std::span<const std::byte> pixels) noexcept {
+    auto padded = std::max(width, height) + 2 * _config.padding;
+    if (width <= 0 || height <= 0 || padded > _config.size) {
+      return SimpleError("cannot fit a {}x{} image into a {} atlas", width,
+                         height, _config.size);
+    }
+    if (pixels.size() < static_cast<std::size_t>(width) *
+                            static_cast<std::size_t>(height) * 4) {
+      return SimpleError("{}x{} RGBA8 image needs {} bytes, got {}", width,
+                         height, width * height * 4, pixels.size());
+    }
+    if (_freeIds.empty() && _regions.size() >= ATLAS_MAX_REGIONS) {
+      return SimpleError("texture atlas is out of region ids");
+    }
+    AUTO_RESULT(region, place(width + 2 * _config.padding,
+                              height + 2 * _config.padding));
+    CHECK_RESULT(upload(region, width, height, pixels));
+
+    AtlasRegionId id;
+    if (_freeIds.empty()) {
+      id = static_cast<AtlasRegionId>(_regions.size());
+      _regions.push_back(region);
+    } else {
+      id = _freeIds.back();
+      _freeIds.pop_back();
+      _regions[id] = region;
+    }
+    _liveArea += area(region.rect);
+    _packedArea += area(region.rect);
+    _regionsDirty = true;
+    return id;
+  }
+
+  /* Frees the id for reuse; its texels are reclaimed by the next
+   * defragmentation. */
+  void remove(AtlasRegionId id) noexcept {
+    if (id == ATLAS_WHITE_REGION || id >= _regions.size() ||
+        !_regions[id].live) {
+      return;
+    }
+    _regions[id].live = false;
+    _liveArea -= area(_regions[id].rect);
+    _freeIds.push_back(id);
+  }
+
+  /* Repacks the live regions tallest first into a fresh texture with
+   * glCopyImageSubData, so nothing round-trips through the CPU. Ids are
+   * kept; the texture object changes. */
+  VoidResult defragment() noexcept {
+    std::vector<std::size_t> order;
+    for (std::size_t i = 0; i < _regions.size(); ++i) {
+      if (_regions[i].live) {
+        order.push_back(i);
+      }
+    }
+    std::ranges::sort(order, [&](std::size_t a, std::size_t b) {
+      return _regions[a].rect.height > _regions[b].rect.height;
+    });
+
+    std::vector<SkylinePacker> packers;
+    std::vector<Region> moved(_regions);
+    for (auto index : order) {
+      const auto &rect = _regions[index].rect;
+      std::optional<AtlasRect> placed;
+      std::size_t layer = 0;
+      while (!placed) {
+        if (layer == packers.size()) {
+          packers.emplace_back(_config.size, _config.size);
+        }
+        placed = packers[layer].insert(rect.width, rect.height);
+        if (!placed) {
+          ++layer;
+        }
+      }
+      moved[index].rect = *placed;
+      moved[index].layer = static_cast<GLint>(layer);
+    }
+    // The new layout never needs more layers than the current one: the
+    // same rectangles fitted before, and tallest-first only packs tighter
+    // in practice. Bail out rather than grow if it does not.
+    auto layers =
+        std::max(static_cast<GLsizei>(packers.size()), _config.initialLayers);
+    if (layers > _texture->layers()) {
+      return {};
+    }
+    while (packers.size() < static_cast<std::size_t>(layers)) {
+      packers.emplace_back(_config.size, _config.size);
+    }
+
+    UNIQUE_RESULT(texture, Texture::create2DArray(GL_RGBA8, _config.size,
+                                                  _config.size, layers));
+    for (auto index : order) {
+      const auto &from = _regions[index];
+      const auto &to = moved[index];
+      CHECK_RESULT(GL::instance().copyImageSubData(
+          _texture->id(), GL_TEXTURE_2D_ARRAY, 0, from.rect.x, from.rect.y,
+          from.layer, texture.id(), GL_TEXTURE_2D_ARRAY, 0, to.rect.x,
+          to.rect.y, to.layer, from.rect.width, from.rect.height, 1));
+    }
+    _texture.reset();
+    _texture.emplace(std::move(texture));
+    _packers = std::move(packers);
+    _regions = std::move(moved);
+    _packedArea = _liveArea;
+    _regionsDirty = true;
+    _defragmentations++;
+    return {};
+  }
+
+  /* Call once per frame: defragments when due and uploads region changes. */
+  VoidResult update() noexcept {
+    if (_config.defragmentInterval != 0 &&
+        ++_updates % _config.defragmentInterval == 0 && _packedArea != 0 &&
+        static_cast<float>(_liveArea) <
+            _config.defragmentBelow * static_cast<float>(_packedArea)) {
+      CHECK_RESULT(defragment());
+    }
+    return flushRegions();
+  }
+
+  /* Binds the texture and the region SSBO for sprite_compact.vert. */
+  VoidResult bind(GLuint textureUnit = 0, GLuint regionBinding = 1) noexcept {
+    CHECK_RESULT(GL::instance().bindTextureUnit(textureUnit, _texture->id()));
+    return GL::instance().bindBufferBase(GL_SHADER_STORAGE_BUFFER,
+                                         regionBinding, _regionBuffer);
+  }
+};
+
+} // namespace na::gl
@@ -0,0 +1,197 @@
+module;
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <format>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <memory>
+#include <na_error/macros.hpp>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+export module na_gl_render_sprite:tilemap;
+
+import na_error;
+import na_gl;
+import na_gl_render_common;
+import na_gl_render_sprite_shaders;
+import :texture_atlas;
+
+namespace na::gl {
+
+/* Matches the "Tilemap" block in tilemap.vert; UBO binding 0. */
+export using TilemapShared =
+    GpuStruct<"Tilemap", GpuLayoutRule::Std140, GpuField<"view", glm::mat4>,
+              GpuField<"projection", glm::mat4>, GpuField<"origin", glm::vec2>,
+              GpuField<"tileSize", glm::vec2>>;
+
+export std::array<ShaderSource, 2> tilemapShaderSources() noexcept {
+  const auto &pack = na_gl_render_sprite_shaders::PACK;
+  return {{
+      {GL_VERTEX_SHADER, pack.find("tilemap.vert")->source},
+      {GL_FRAGMENT_SHADER, pack.find("tilemap.frag")->source},
+  }};
+}
+
+export std::array<ShaderFile, 2> tilemapShaderFiles() noexcept {
+  constexpr std::string_view dir = NA_GL_RENDER_SPRITE_SHADER_DIR;
+  return {{
+      {GL_VERTEX_SHADER, std::format("{}/tilemap.vert", dir)},
+      {GL_FRAGMENT_SHADER, std::format("{}/tilemap.frag", dir)},
+  }};
+}
+
+export struct TilemapConfig {
+  GLsizei columns;
+  GLsizei rows;
+  /* World position of the bottom-left corner of cell (0, 0). */
+  glm::vec2 origin{0.0f};
+  glm::vec2 tileSize{1.0f};
+};
+
+/* A grid of atlas tiles drawn as a single quad: cells live in an R16UI
+ * texture of AtlasRegionId that tilemap.frag resolves per pixel, so the CPU
+ * cost of a frame depends on the cells changed, not the board size. Tile 0
+ * (ATLAS_WHITE_REGION) marks an empty cell and is not drawn. */
+export class Tilemap {
+  struct DirtySpan {
+    GLsizei first;
+    GLsizei end;
+  };
+
+  TilemapConfig _config;
+  std::optional<Texture> _cells;
+  GLuint _uniformBuffer{};
+  GLuint _vertexArray{};
+  std::vector<AtlasRegionId> _tiles;
+  /* Changed columns per row, and the rows that have any. */
+  std::vector<DirtySpan> _dirtySpans;
+  std::vector<GLsizei> _dirtyRows;
+  TilemapShared _shared{};
+  bool _sharedDirty = true;
+
+  explicit Tilemap(TilemapConfig config) noexcept
+      : _config(config),
+        _tiles(static_cast<std::size_t>(config.columns) *
+                   static_cast<std::size_t>(config.rows),
+               ATLAS_WHITE_REGION),
+        _dirtySpans(static_cast<std::size_t>(config.rows),
+                    {.first = config.columns, .end = 0}) {
+    _shared.set<"origin">(config.origin).set<"tileSize">(config.tileSize);
+  }
+
+  std::size_t index(GLsizei x, GLsizei y) const noexcept {
+    return static_cast<std::size_t>(y) *
+               static_cast<std::size_t>(_config.columns) +
+           static_cast<std::size_t>(x);
+  }
+
+  void markDirty(GLsizei x, GLsizei y) noexcept {
+    auto &span = _dirtySpans[static_cast<std::size_t>(y)];
+    if (span.first >= span.end) {
+      _dirtyRows.push_back(y);
+    }
+    span.first = std::min(span.first, x);
+    span.end = std::max(span.end, x + 1);
+  }
+
+  /* Uploads each changed row span with one glTextureSubImage2D. */
+  VoidResult flushCells() noexcept {
+    for (auto y : _dirtyRows) {
+      auto &span = _dirtySpans[static_cast<std::size_t>(y)];
+      auto width = span.end - span.first;
+      CHECK_RESULT(GL::instance().textureSubImage2D(
+          _cells->id(), 0, span.first, y, width, 1, GL_RED_INTEGER,
+          GL_UNSIGNED_SHORT, _tiles.data() + index(span.first, y),
+          static_cast<std::size_t>(width) * sizeof(AtlasRegionId)));
+      span = {.first = _config.columns, .end = 0};
+    }
+    _dirtyRows.clear();
+    return {};
+  }
+
+public:
+  Tilemap(const Tilemap &) = delete;
+  Tilemap &operator=(const Tilemap &) = delete;
+
+  ~Tilemap() noexcept {
+    if (_uniformBuffer != 0) {
+      GL::instance().deleteBuffer(_uniformBuffer);
+    }
+    if (_vertexArray != 0) {
+      GL::instance().deleteVertexArray(_vertexArray);
+    }
+  }
+
+  static UniqueResult<Tilemap> create(TilemapConfig config) noexcept {
+    UNIQUE_RESULT(cells,
+                  Texture::create2D(GL_R16UI, config.columns, config.rows));
+    auto tilemap = std::unique_ptr<Tilemap>(new Tilemap(config));
+    tilemap->_cells.emplace(std::move(cells));
+    AUTO_RESULT(uniformBuffer, GL::instance().createBuffer());
+    tilemap->_uniformBuffer = uniformBuffer;
+    CHECK_RESULT(GL::instance().namedBufferStorage(
+        uniformBuffer, TilemapShared::SIZE, nullptr, GL_DYNAMIC_STORAGE_BIT));
+    AUTO_RESULT(vertexArray, GL::instance().createVertexArray());
+    tilemap->_vertexArray = vertexArray;
+    // Storage starts undefined; upload the empty board once.
+    for (GLsizei y = 0; y < config.rows; ++y) {
+      tilemap->markDirty(0, y);
+      tilemap->markDirty(config.columns - 1, y);
+    }
+    return tilemap;
+  }
+
+  GLsizei columns() const noexcept { return _config.columns; }
+
+  GLsizei rows() const noexcept { return _config.rows; }
+
+  AtlasRegionId tile(GLsizei x, GLsizei y) const noexcept {
+    if (x < 0 || y < 0 || x >= _config.columns || y >= _config.rows) {
+      return ATLAS_WHITE_REGION;
+    }
+    return _tiles[index(x, y)];
+  }
+
+  /* Cells outside the map are ignored. */
+  void set(GLsizei x, GLsizei y, AtlasRegionId tile) noexcept {
+    if (x < 0 || y < 0 || x >= _config.columns || y >= _config.rows) {
+      return;
+    }
+    auto &cell = _tiles[index(x, y)];
+    if (cell != tile) {
+      cell = tile;
+      markDirty(x, y);
+    }
+  }
+
+  void setCamera(const glm::mat4 &view, const glm::mat4 &projection) noexcept {
+    _shared.set<"view">(view).set<"projection">(projection);
+    _sharedDirty = true;
+  }
+
+  /* Draws the map with a program built from tilemapShaderSources(); binds
+   * the atlas to texture unit 0 and SSBO binding 1 and the cells to texture
+   * unit 1. */
+  VoidResult draw(const ShaderProgram &program, TextureAtlas &atlas) noexcept {
+    CHECK_RESULT(flushCells());
+    if (_sharedDirty) {
+      CHECK_RESULT(GL::instance().namedBufferSubData(
+          _uniformBuffer, 0, TilemapShared::SIZE, &_shared));
+      _sharedDirty = false;
+    }
+    CHECK_RESULT(GL::instance().useProgram(program.id()));
+    CHECK_RESULT(atlas.bind(0, 1));
+    CHECK_RESULT(GL::instance().bindTextureUnit(1, _cells->id()));
+    CHECK_RESULT(
+        GL::instance().bindBufferBase(GL_UNIFORM_BUFFER, 0, _uniformBuffer));
+    CHECK_RESULT(GL::instance().bindVertexArray(_vertexArray));
+    return GL::instance().drawArrays(GL_TRIANGLE_FAN, 0, 4);
+  }
+};
+
+} // namespace na::gl
@@ -0,0 +1,162 @@
+module;
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+
+export module na_gl_render_text:bitmap_font;
+
+namespace na::gl {
+
+/* Built-in 5x7 pixel font. Every glyph is rendered into a cell with
+ * FONT_MARGIN empty pixels around it so its distance field can fall off. */
+export constexpr int FONT_COLUMNS = 5;
+export constexpr int FONT_ROWS = 7;
+export constexpr int FONT_MARGIN = 1;
+export constexpr int FONT_CELL_WIDTH = FONT_COLUMNS + 2 * FONT_MARGIN;
+export constexpr int FONT_CELL_HEIGHT = FONT_ROWS + 2 * FONT_MARGIN;
+/* Pen advance and line height, in font pixels. */
+export constexpr int FONT_ADVANCE = FONT_COLUMNS + 1;
+export constexpr int FONT_LINE_HEIGHT = FONT_ROWS + 2;
+
+/* Distance field texels per font pixel, and the distance in font pixels that
+ * maps to the full 0..1 range around the 0.5 edge. */
+export constexpr int SDF_SCALE = 4;
+export constexpr float SDF_SPREAD = static_cast<float>(FONT_MARGIN);
+export constexpr int SDF_WIDTH = FONT_CELL_WIDTH * SDF_SCALE;
+export constexpr int SDF_HEIGHT = FONT_CELL_HEIGHT * SDF_SCALE;
+
+export struct BitmapGlyph {
+  char character;
+  /* Top row first; bit 4 is the leftmost pixel. */
+  std::array<std::uint8_t, FONT_ROWS> rows;
+};
+
+export inline constexpr BitmapGlyph BITMAP_FONT[] = {
+    {'?', {0x0E, 0x11, 0x01, 0x02, 0x04, 0x00, 0x04}},
+    {' ', {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
+    {'!', {0x04, 0x04, 0x04, 0x04, 0x00, 0x00, 0x04}},
+    {'"', {0x0A, 0x0A, 0x0A, 0x00, 0x00, 0x00, 0x00}},
+    {'#', {0x0A, 0x0A, 0x1F, 0x0A, 0x1F, 0x0A, 0x0A}},
+    {'%', {0x18, 0x19, 0x02, 0x04, 0x08, 0x13, 0x03}},
+    {'\'', {0x0C, 0x04, 0x08, 0x00, 0x00, 0x00, 0x00}},
+    {'(', {0x02, 0x04, 0x08, 0x08, 0x08, 0x04, 0x02}},
+    {')', {0x08, 0x04, 0x02, 0x02, 0x02, 0x04, 0x08}},
+    {'*', {0x00, 0x04, 0x15, 0x0E, 0x15, 0x04, 0x00}},
+    {'+', {0x00, 0x04, 0x04, 0x1F, 0x04, 0x04, 0x00}},
+    {',', {0x00, 0x00, 0x00, 0x00, 0x0C, 0x04, 0x08}},
+    {'-', {0x00, 0x00, 0x00, 0x1F, 0x00, 0x00, 0x00}},
+    {'.', {0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C}},
+    {'/', {0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x00}},
+    {'0', {0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E}},
+    {'1', {0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E}},
+    {'2', {0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F}},
+    {'3', {0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E}},
+    {'4', {0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02}},
+    {'5', {0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E}},
+    {'6', {0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E}},
+    {'7', {0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08}},
+    {'8', {0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E}},
+    {'9', {0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C}},
+    {':', {0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x0C, 0x00}},
+    {';', {0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x04, 0x08}},
+    {'<', {0x02, 0x04, 0x08, 0x10, 0x08, 0x04, 0x02}},
+    {'=', {0x00, 0x00, 0x1F, 0x00, 0x1F, 0x00, 0x00}},
+    {'>', {0x08, 0x04, 0x02, 0x01, 0x02, 0x04, 0x08}},
+    {'A', {0x0E, 0x11, 0x11, 0x11, 0x1F, 0x11, 0x11}},
+    {'B', {0x1E, 0x11, 0x11, 0x1E, 0x11, 0x11, 0x1E}},
+    {'C', {0x0E, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0E}},
+    {'D', {0x1C, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1C}},
+    {'E', {0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x1F}},
+    {'F', {0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x10}},
+    {'G', {0x0E, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0F}},
+    {'H', {0x11, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11}},
+    {'I', {0x0E, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E}},
+    {'J', {0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0C}},
+    {'K', {0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11}},
+    {'L', {0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1F}},
+    {'M', {0x11, 0x1B, 0x15, 0x15, 0x11, 0x11, 0x11}},
+    {'N', {0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11}},
+    {'O', {0x0E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E}},
+    {'P', {0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10, 0x10}},
+    {'Q', {0x0E, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0D}},
+    {'R', {0x1E, 0x11, 0x11, 0x1E, 0x14, 0x12, 0x11}},
+    {'S', {0x0F, 0x10, 0x10, 0x0E, 0x01, 0x01, 0x1E}},
+    {'T', {0x1F, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04}},
+    {'U', {0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E}},
+    {'V', {0x11, 0x11, 0x11, 0x11, 0x11, 0x0A, 0x04}},
+    {'W', {0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0A}},
+    {'X', {0x11, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x11}},
+    {'Y', {0x11, 0x11, 0x11, 0x0A, 0x04, 0x04, 0x04}},
+    {'Z', {0x1F, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1F}},
+    {'[', {0x0E, 0x08, 0x08, 0x08, 0x08, 0x08, 0x0E}},
+    {']', {0x0E, 0x02, 0x02, 0x02, 0x02, 0x02, 0x0E}},
+    {'_', {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1F}},
+};
+
+export constexpr std::size_t BITMAP_FONT_GLYPHS = std::size(BITMAP_FONT);
+
+/* Index into BITMAP_FONT for a character; lowercase maps to uppercase and
+ * anything missing to '?' (index 0). */
+export constexpr std::size_t bitmapGlyphIndex(char character) noexcept {
+  if (character >= 'a' && character <= 'z') {
+    character = static_cast<char>(character - 'a' + 'A');
+  }
+  for (std::size_t i = 0; i < BITMAP_FONT_GLYPHS; ++i) {
+    if (BITMAP_FONT[i].character == character) {
+      return i;
+    }
+  }
+  return 0;
+}
+
+/* Renders a glyph cell as an 8-bit signed distance field, top row first:
+ * 128 on the outline, rising inside. Pixels are squares, so the exact
+ * distance is the nearest pixel of the opposite state. */
+export void renderGlyphSdf(
+    const BitmapGlyph &glyph,
+    std::span<std::uint8_t, SDF_WIDTH * SDF_HEIGHT> output) noexcept {
+  auto filled = [&](int x, int y) noexcept {
+    auto column = x - FONT_MARGIN;
+    auto row = y - FONT_MARGIN;
+    if (column < 0 || row < 0 || column >= FONT_COLUMNS || row >= FONT_ROWS) {
+      return false;
+    }
+    return ((glyph.rows[static_cast<std::size_t>(row)] >>
+             (FONT_COLUMNS - 1 - column)) &
+            1) != 0;
+  };
+  for (int ty = 0; ty < SDF_HEIGHT; ++ty) {
+    for (int tx = 0; tx < SDF_WIDTH; ++tx) {
+      // Texel centre in font pixels.
+      auto px = (static_cast<float>(tx) + 0.5f) / SDF_SCALE;
+      auto py = (static_cast<float>(ty) + 0.5f) / SDF_SCALE;
+      auto inside = filled(static_cast<int>(px), static_cast<int>(py));
+      auto nearest = std::numeric_limits<float>::max();
+      for (int y = 0; y < FONT_CELL_HEIGHT; ++y) {
+        for (int x = 0; x < FONT_CELL_WIDTH; ++x) {
+          if (filled(x, y) == inside) {
+            continue;
+          }
+          auto dx = std::max(std::abs(px - (static_cast<float>(x) + 0.5f)) -
+                                 0.5f,
+                             0.0f);
+          auto dy = std::max(std::abs(py - (static_cast<float>(y) + 0.5f)) -
+                                 0.5f,
+                             0.0f);
+          nearest = std::min(nearest, std::sqrt(dx * dx + dy * dy));
+        }
+      }
+      auto distance = inside ? nearest : -nearest;
+      auto value = std::clamp(0.5f + 0.5f * distance / SDF_SPREAD, 0.0f, 1.0f);
+      output[static_cast<std::size_t>(ty * SDF_WIDTH + tx)] =
+          static_cast<std::uint8_t>(std::lround(value * 255.0f));
+    }
+  }
+}
+
+} // namespace na::gl
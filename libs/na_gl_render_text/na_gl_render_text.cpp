@@ -0,0 +1,4 @@
+export module na_gl_render_text;
+
+export import :bitmap_font;
+export import :text_renderer;
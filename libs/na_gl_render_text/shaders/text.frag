@@ -0,0 +1,15 @@
+#version 450 core
+
+layout (binding = 0) uniform sampler2DArray glyphs;
+
+layout (location = 0) in vec4 inColor;
+layout (location = 1) in vec3 inTexCoord;
+layout (location = 0) out vec4 outColor;
+
+void main() {
+  float field = texture(glyphs, inTexCoord).r;
+  // One screen pixel of antialiasing whatever the glyph's scale.
+  float width = max(fwidth(field), 1e-4);
+  float alpha = smoothstep(0.5 - width, 0.5 + width, field);
+  outColor = vec4(inColor.rgb, inColor.a * alpha);
+}
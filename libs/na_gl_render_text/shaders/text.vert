@@ -0,0 +1,45 @@
+#version 450 core
+
+struct Glyph {
+  vec2 position;
+  float scale;
+  uint glyph;
+  uint color;
+  uint reserved;
+};
+
+layout (binding = 0) uniform Shared {
+  mat4 view;
+  mat4 projection;
+};
+
+layout (binding = 0, std430) readonly buffer Glyphs {
+  Glyph glyphs[];
+};
+
+// Glyph cells in font pixels; matches FONT_CELL_WIDTH/HEIGHT.
+const vec2 CELL = vec2(7.0, 9.0);
+
+vec2 vertices[4] = vec2[](
+  vec2(0.0, 0.0),
+  vec2(1.0, 0.0),
+  vec2(1.0, 1.0),
+  vec2(0.0, 1.0)
+);
+
+layout (location = 0) out vec4 outColor;
+layout (location = 1) out vec3 outTexCoord;
+
+out gl_PerVertex {
+  vec4 gl_Position;
+};
+
+void main() {
+  Glyph glyph = glyphs[gl_InstanceID];
+  vec2 corner = vertices[gl_VertexID];
+  vec2 position = glyph.position + corner * CELL * glyph.scale;
+  outColor = unpackUnorm4x8(glyph.color);
+  // Distance fields are stored top row first.
+  outTexCoord = vec3(corner.x, 1.0 - corner.y, float(glyph.glyph));
+  gl_Position = projection * view * vec4(position, 0.0, 1.0);
+}
@@ -0,0 +1,291 @@
+module;
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <format>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+#include <memory>
+#include <na_error/macros.hpp>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+export module na_gl_render_text:text_renderer;
+
+import na_error;
+import na_gl;
+import na_gl_render_common;
+import na_gl_render_sprite;
+import na_gl_render_text_shaders;
+import :bitmap_font;
+
+namespace na::gl {
+
+/* Matches "Glyph" in text.vert: the bottom-left corner of the glyph cell,
+ * world units per font pixel, the glyph's layer in the SDF array and an
+ * RGBA8 color. A scale of 0 hides the slot. */
+export using GlyphInstance =
+    GpuStruct<"Glyph", GpuLayoutRule::Std430, GpuField<"position", glm::vec2>,
+              GpuField<"scale", float>, GpuField<"glyph", std::uint32_t>,
+              GpuField<"color", std::uint32_t>,
+              GpuField<"reserved", std::uint32_t>>;
+
+export std::array<ShaderSource, 2> textShaderSources() noexcept {
+  const auto &pack = na_gl_render_text_shaders::PACK;
+  return {{
+      {GL_VERTEX_SHADER, pack.find("text.vert")->source},
+      {GL_FRAGMENT_SHADER, pack.find("text.frag")->source},
+  }};
+}
+
+export std::array<ShaderFile, 2> textShaderFiles() noexcept {
+  constexpr std::string_view dir = NA_GL_RENDER_TEXT_SHADER_DIR;
+  return {{
+      {GL_VERTEX_SHADER, std::format("{}/text.vert", dir)},
+      {GL_FRAGMENT_SHADER, std::format("{}/text.frag", dir)},
+  }};
+}
+
+export using TextLabelId = std::uint32_t;
+
+/* Retained text drawn from SDF glyphs in one instanced draw. Every glyph of
+ * the built-in font is rendered into a layer of an R8 texture array at
+ * startup; each label owns a slot range in a static sprite batch and is laid
+ * out again only when its text or style changes, so unchanged labels cost no
+ * CPU work or uploads. The Shared block comes from a CameraBuffer, so text
+ * needs no stream of its own. */
+export class TextRenderer {
+  struct Label {
+    std::string text;
+    glm::vec2 position;
+    /* Height of a capital letter in world units. */
+    float size;
+    glm::vec4 color;
+    std::size_t first;
+    std::size_t capacity;
+    bool live;
+  };
+
+  struct FreeRange {
+    std::size_t first;
+    std::size_t capacity;
+  };
+
+  std::optional<Texture> _glyphs;
+  GLuint _vertexArray{};
+  const CameraBuffer *_cameras = nullptr;
+  CameraId _camera{};
+  std::unique_ptr<BasicStaticSpriteBatch<GlyphInstance>> _batch;
+  std::vector<Label> _labels;
+  std::vector<TextLabelId> _freeLabels;
+  std::vector<FreeRange> _freeRanges;
+
+  TextRenderer() noexcept = default;
+
+  static std::size_t visibleGlyphs(std::string_view text) noexcept {
+    return static_cast<std::size_t>(std::ranges::count_if(
+        text, [](char c) noexcept { return c != ' ' && c != '\n'; }));
+  }
+
+  /* Hides the slots; they stay allocated to their owner. */
+  void clearSlots(std::size_t first, std::size_t count) noexcept {
+    for (auto &slot : _batch->edit(first, count)) {
+      slot.set<"scale">(0.0f);
+    }
+  }
+
+  /* Finds room for count glyphs, reusing a freed range when one fits. */
+  FreeRange allocateSlots(std::size_t count) noexcept {
+    auto capacity = std::bit_ceil(std::max<std::size_t>(count, 8));
+    auto reusable = std::ranges::find_if(_freeRanges, [&](const FreeRange &r) {
+      return r.capacity >= capacity;
+    });
+    if (reusable != _freeRanges.end()) {
+      auto range = *reusable;
+      _freeRanges.erase(reusable);
+      return range;
+    }
+    // New slots start zeroed, which hides them.
+    FreeRange range{.first = _batch->size(), .capacity = capacity};
+    _batch->append(capacity);
+    return range;
+  }
+
+  void layout(Label &label) noexcept {
+    auto count = visibleGlyphs(label.text);
+    if (count > label.capacity) {
+      if (label.capacity != 0) {
+        clearSlots(label.first, label.capacity);
+        _freeRanges.push_back(
+            {.first = label.first, .capacity = label.capacity});
+      }
+      auto range = allocateSlots(count);
+      label.first = range.first;
+      label.capacity = range.capacity;
+    }
+    auto slots = _batch->edit(label.first, label.capacity);
+    auto scale = label.size / static_cast<float>(FONT_ROWS);
+    auto color = glm::packUnorm4x8(label.color);
+    // The pen is at the bottom-left of the first line's capitals; cells
+    // extend FONT_MARGIN pixels beyond that.
+    glm::vec2 pen = label.position;
+    std::size_t slot = 0;
+    for (auto c : label.text) {
+      if (c == '\n') {
+        pen = {label.position.x,
+               pen.y - static_cast<float>(FONT_LINE_HEIGHT) * scale};
+        continue;
+      }
+      if (c != ' ') {
+        slots[slot++]
+            .set<"position">(pen - static_cast<float>(FONT_MARGIN) * scale)
+            .set<"scale">(scale)
+            .set<"glyph">(static_cast<std::uint32_t>(bitmapGlyphIndex(c)))
+            .set<"color">(color);
+      }
+      pen.x += static_cast<float>(FONT_ADVANCE) * scale;
+    }
+    for (; slot < slots.size(); ++slot) {
+      slots[slot].set<"scale">(0.0f);
+    }
+  }
+
+  Label *find(TextLabelId id) noexcept {
+    if (id >= _labels.size() || !_labels[id].live) {
+      return nullptr;
+    }
+    return &_labels[id];
+  }
+
+public:
+  TextRenderer(const TextRenderer &) = delete;
+  TextRenderer &operator=(const TextRenderer &) = delete;
+
+  ~TextRenderer() noexcept {
+    if (_vertexArray != 0) {
+      GL::instance().deleteVertexArray(_vertexArray);
+    }
+  }
+
+  static UniqueResult<TextRenderer> create() noexcept {
+    auto text = std::unique_ptr<TextRenderer>(new TextRenderer());
+    UNIQUE_RESULT(glyphs, Texture::create2DArray(
+                              GL_R8, SDF_WIDTH, SDF_HEIGHT,
+                              static_cast<GLsizei>(BITMAP_FONT_GLYPHS)));
+    std::vector<std::uint8_t> field(SDF_WIDTH * SDF_HEIGHT);
+    for (std::size_t i = 0; i < BITMAP_FONT_GLYPHS; ++i) {
+      renderGlyphSdf(BITMAP_FONT[i],
+                     std::span<std::uint8_t, SDF_WIDTH * SDF_HEIGHT>(field));
+      CHECK_RESULT(GL::instance().textureSubImage3D(
+          glyphs.id(), 0, 0, 0, static_cast<GLint>(i), SDF_WIDTH, SDF_HEIGHT,
+          1, GL_RED, GL_UNSIGNED_BYTE, field.data(), field.size()));
+    }
+    text->_glyphs.emplace(std::move(glyphs));
+    AUTO_RESULT(vertexArray, GL::instance().createVertexArray());
+    text->_vertexArray = vertexArray;
+    UNIQUE_RESULT(batch, BasicStaticSpriteBatch<GlyphInstance>::create(256));
+    text->_batch = std::move(batch);
+    return text;
+  }
+
+  TextLabelId addLabel(std::string_view text, glm::vec2 position, float size,
+                       glm::vec4 color = glm::vec4(1.0f)) noexcept {
+    TextLabelId id;
+    if (_freeLabels.empty()) {
+      id = static_cast<TextLabelId>(_labels.size());
+      _labels.emplace_back();
+    } else {
+      id = _freeLabels.back();
+      _freeLabels.pop_back();
+    }
+    _labels[id] = {.text = std::string(text),
+                   .position = position,
+                   .size = size,
+                   .color = color,
+                   .first = 0,
+                   .capacity = 0,
+                   .live = true};
+    layout(_labels[id]);
+    return id;
+  }
+
+  void removeLabel(TextLabelId id) noexcept {
+    auto *label = find(id);
+    if (label == nullptr) {
+      return;
+    }
+    if (label->capacity != 0) {
+      clearSlots(label->first, label->capacity);
+      _freeRanges.push_back(
+          {.first = label->first, .capacity = label->capacity});
+    }
+    label->live = false;
+    label->text.clear();
+    _freeLabels.push_back(id);
+  }
+
+  /* Lays the label out again only when the text differs. */
+  void setText(TextLabelId id, std::string_view text) noexcept {
+    if (auto *label = find(id); label != nullptr && label->text != text) {
+      label->text = text;
+      layout(*label);
+    }
+  }
+
+  void setPosition(TextLabelId id, glm::vec2 position) noexcept {
+    if (auto *label = find(id);
+        label != nullptr && label->position != position) {
+      label->position = position;
+      layout(*label);
+    }
+  }
+
+  void setColor(TextLabelId id, glm::vec4 color) noexcept {
+    if (auto *label = find(id); label != nullptr && label->color != color) {
+      label->color = color;
+      layout(*label);
+    }
+  }
+
+  /* draw() binds this camera's slot, so the buffer's beginFrame() must
+   * precede it. */
+  void setCamera(const CameraBuffer &cameras, CameraId camera) noexcept {
+    _cameras = &cameras;
+    _camera = camera;
+  }
+
+  /* Draws every label with one instanced draw, blended over the frame, using
+   * a program built from textShaderSources(). */
+  VoidResult draw(const ShaderProgram &program) noexcept {
+    if (_cameras == nullptr) {
+      return SimpleError("text renderer has no camera");
+    }
+    CHECK_RESULT(_batch->flush());
+    if (_batch->size() == 0) {
+      return {};
+    }
+    CHECK_RESULT(_cameras->bind(_camera));
+    CHECK_RESULT(GL::instance().bindBufferRange(
+        GL_SHADER_STORAGE_BUFFER, 0, _batch->id(), 0,
+        static_cast<GLsizeiptr>(_batch->size() * GlyphInstance::SIZE)));
+    CHECK_RESULT(GL::instance().useProgram(program.id()));
+    CHECK_RESULT(GL::instance().bindTextureUnit(0, _glyphs->id()));
+    CHECK_RESULT(GL::instance().bindVertexArray(_vertexArray));
+    CHECK_RESULT(GL::instance().enable(GL_BLEND));
+    CHECK_RESULT(
+        GL::instance().blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA));
+    auto drawn = GL::instance().drawArraysInstanced(
+        GL_TRIANGLE_FAN, 0, 4, static_cast<GLsizei>(_batch->size()));
+    CHECK_RESULT(GL::instance().disable(GL_BLEND));
+    return drawn;
+  }
+};
+
+} // namespace na::gl
@@ -1,9 +1,11 @@
 module;
 
+#include <cstdint>
 #include <string>
 
 export module na_glfwapp:application;
 import na_error;
+import na_gl;
 
 namespace na {
 
@@ -11,11 +13,19 @@ export struct GlfwApplicationConfig {
   std::string title;
   int width;
   int height;
+  /* When set, per-frame GL statistics are streamed to this file. */
+  std::string statsStreamPath{};
+  GlStatsStreamFormat statsStreamFormat = GlStatsStreamFormat::None;
+  /* Disable to measure frame times unthrottled by the display. */
+  bool vsync = true;
 };
 
 export struct GlfwApplicationState {
   int width;
   int height;
+  std::uint64_t frame;
+  /* GL work submitted during the previous frame. */
+  GlFrameStats lastFrameStats;
 };
 
 export class GlfwApplication {
@@ -27,5 +37,7 @@ public:
   virtual VoidResult onUpdate(const GlfwApplicationState &) noexcept {
     return {};
   }
+  /* Checked after every frame; lets an application end the run loop. */
+  virtual bool shouldClose() const noexcept { return false; }
 };
 }; // namespace na
\ No newline at end of file
@@ -3,10 +3,13 @@ module;
 #include <glad/glad.h>
 
 #include <GLFW/glfw3.h>
+#include <cstdint>
 #include <na_error/macros.hpp>
+#include <optional>
 
 export module na_glfwapp:runner;
 import na_error;
+import na_gl;
 import :application;
 
 namespace na {
@@ -29,14 +32,32 @@ export VoidResult runGlfwApplication(const GlfwApplicationConfig &config,
   }
   glfwMakeContextCurrent(window);
   gladLoadGLLoader(reinterpret_cast<GLADloadproc>(glfwGetProcAddress));
+  glfwSwapInterval(config.vsync ? 1 : 0);
+
+  std::optional<GlStatsStream> statsStream;
+  if (config.statsStreamFormat != GlStatsStreamFormat::None) {
+    auto stream =
+        GlStatsStream::open(config.statsStreamPath, config.statsStreamFormat);
+    if (stream.failed()) {
+      glfwDestroyWindow(window);
+      glfwTerminate();
+      return stream.error();
+    }
+    statsStream.emplace(std::move(stream.value()));
+  }
 
   bool initialized = false;
   VoidResult result{};
+  std::uint64_t frame = 0;
+  GlFrameStats lastFrameStats{};
+  GL::instance().resetFrameStats();
 
   while (!glfwWindowShouldClose(window)) {
     GlfwApplicationState state{
         .width = config.width,
         .height = config.height,
+        .frame = frame,
+        .lastFrameStats = lastFrameStats,
     };
     if (!initialized) {
       result = app.onInit(state);
@@ -49,8 +70,17 @@ export VoidResult runGlfwApplication(const GlfwApplicationConfig &config,
     if (!result.ok()) {
       break;
     }
+    lastFrameStats = GL::instance().frameStats();
+    GL::instance().resetFrameStats();
+    if (statsStream) {
+      statsStream->write(frame, lastFrameStats);
+    }
+    frame++;
     glfwSwapBuffers(window);
     glfwPollEvents();
+    if (app.shouldClose()) {
+      break;
+    }
   }
 
   glfwDestroyWindow(window);
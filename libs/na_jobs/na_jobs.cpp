@@ -0,0 +1,3 @@
+export module na_jobs;
+
+export import :thread_pool;
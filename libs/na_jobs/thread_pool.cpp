@@ -0,0 +1,169 @@
+module;
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <latch>
+#include <memory>
+#include <mutex>
+#include <na_error/macros.hpp>
+#include <stop_token>
+#include <thread>
+#include <utility>
+#include <vector>
+
+export module na_jobs:thread_pool;
+
+import na_error;
+
+namespace na {
+
+/* A range split into chunks that any number of threads claim with one
+ * atomic increment each; done counts finished chunks down. */
+struct ParallelForJob {
+  std::function<void(std::size_t, std::size_t)> body;
+  std::size_t count;
+  std::size_t grain;
+  std::size_t chunks;
+  std::atomic<std::size_t> next{0};
+  std::latch done;
+
+  ParallelForJob(std::function<void(std::size_t, std::size_t)> body,
+                 std::size_t count, std::size_t grain) noexcept
+      : body(std::move(body)), count(count), grain(grain),
+        chunks((count + grain - 1) / grain),
+        done(static_cast<std::ptrdiff_t>(chunks)) {}
+
+  void runChunks() noexcept {
+    while (true) {
+      auto chunk = next.fetch_add(1, std::memory_order_relaxed);
+      if (chunk >= chunks) {
+        return;
+      }
+      auto begin = chunk * grain;
+      body(begin, std::min(begin + grain, count));
+      done.count_down();
+    }
+  }
+};
+
+/* Completion of a ThreadPool::parallelFor(). wait() runs unclaimed chunks
+ * on the calling thread before blocking, so the caller is never idle while
+ * work is left; the destructor waits too. */
+export class ParallelFor {
+  friend class ThreadPool;
+
+  std::shared_ptr<ParallelForJob> _job;
+
+  explicit ParallelFor(std::shared_ptr<ParallelForJob> job) noexcept
+      : _job(std::move(job)) {}
+
+public:
+  /* Already complete. */
+  ParallelFor() noexcept = default;
+
+  ParallelFor(const ParallelFor &) = delete;
+  ParallelFor &operator=(const ParallelFor &) = delete;
+  ParallelFor(ParallelFor &&) noexcept = default;
+
+  ParallelFor &operator=(ParallelFor &&other) noexcept {
+    wait();
+    _job = std::move(other._job);
+    return *this;
+  }
+
+  ~ParallelFor() noexcept { wait(); }
+
+  bool done() const noexcept { return !_job || _job->done.try_wait(); }
+
+  void wait() noexcept {
+    if (_job) {
+      _job->runChunks();
+      _job->done.wait();
+      _job.reset();
+    }
+  }
+};
+
+/* A fixed set of worker threads for data-parallel loops. The loop body
+ * must not call back into the pool's wait() of an enclosing loop. */
+export class ThreadPool {
+  std::mutex _mutex;
+  std::condition_variable_any _wake;
+  std::deque<std::shared_ptr<ParallelForJob>> _jobs;
+  std::vector<std::jthread> _workers;
+
+  ThreadPool() noexcept = default;
+
+  void run(std::stop_token stopToken) noexcept {
+    while (true) {
+      std::shared_ptr<ParallelForJob> job;
+      {
+        std::unique_lock lock(_mutex);
+        if (!_wake.wait(lock, stopToken, [&] { return !_jobs.empty(); })) {
+          return;
+        }
+        job = _jobs.front();
+      }
+      job->runChunks();
+      // Every chunk is claimed; retire the job so idle workers sleep.
+      std::lock_guard lock(_mutex);
+      if (!_jobs.empty() && _jobs.front() == job) {
+        _jobs.pop_front();
+      }
+    }
+  }
+
+public:
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  ~ThreadPool() noexcept {
+    for (auto &worker : _workers) {
+      worker.request_stop();
+    }
+    _workers.clear();
+  }
+
+  /* workers == 0 leaves one hardware thread for the caller. */
+  static UniqueResult<ThreadPool> create(std::size_t workers = 0) noexcept {
+    if (workers == 0) {
+      workers = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+    }
+    auto pool = std::unique_ptr<ThreadPool>(new ThreadPool());
+    pool->_workers.reserve(workers);
+    for (std::size_t i = 0; i < workers; ++i) {
+      pool->_workers.emplace_back(
+          [pool = pool.get()](std::stop_token stopToken) {
+            pool->run(stopToken);
+          });
+    }
+    return pool;
+  }
+
+  std::size_t workers() const noexcept { return _workers.size(); }
+
+  /* Calls body(begin, end) over [0, count) in chunks of grain items from the
+   * workers and the thread that waits on the result. Chunks run in no
+   * particular order; body must only touch its own range. */
+  ParallelFor parallelFor(
+      std::size_t count, std::size_t grain,
+      std::function<void(std::size_t, std::size_t)> body) noexcept {
+    if (count == 0) {
+      return {};
+    }
+    auto job = std::make_shared<ParallelForJob>(
+        std::move(body), count, std::max<std::size_t>(grain, 1));
+    {
+      std::lock_guard lock(_mutex);
+      _jobs.push_back(job);
+    }
+    _wake.notify_all();
+    return ParallelFor(std::move(job));
+  }
+};
+
+} // namespace na